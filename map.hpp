@@ -39,19 +39,11 @@ public:
 		Node *point;
 		int height;
 
-		Node() {};
+		Node(): data(nullptr), left(nullptr), right(nullptr), prev(nullptr), next(nullptr), height(0) {}
 		Node(const value_type &_data, Node *lt = nullptr, Node *rt = nullptr, Node *_pre = nullptr, Node *_next = nullptr, int h = 1)
 			:left(lt), right(rt), prev(_pre), next(_next), height(h) {
 			data = new value_type(_data);
 		 };
-		//const???!!!
-		Node(Node &other) {
-			data = new value_type(*other.data);
-			height = other.height;
-			other.point = this;    //֪ɲУ
-			if (other.left != nullptr) left = new Node(*other.left); else left = nullptr;
-			if (other.right != nullptr) right = new Node(*other.right); else right = nullptr;
-		};
 		~Node() { delete data; }
 	};
 
@@ -59,6 +51,8 @@ public:
 		Node *root;
 		Node *head, *tail;
 		int size;
+		//nڵAVL߶Ȳ 1.44 log2(n)·ö͹
+		static const int MAXH = 96;
 	public:
 		friend class map<Key, T, Compare>;
 		Tree() { 
@@ -71,14 +65,21 @@ public:
 			head = new Node; tail = new Node;
 			other.head->point = head; 
 			other.tail->point = tail;
-			if (other.size > 0)
+			root = nullptr;
+			size = other.size;
+			//ƣջݹ
+			Node *src[MAXH];
+			Node **dst[MAXH];
+			int top = 0;
+			if (other.root != nullptr) { src[top] = other.root; dst[top++] = &root; }
+			while (top > 0)
 			{
-				root = new Node(*other.root);
-				size = other.size;
-			}
-			else {
-				root = nullptr;
-				size = 0;
+				--top;
+				Node *o = src[top];
+				Node *now = *dst[top] = new Node(*o->data, nullptr, nullptr, nullptr, nullptr, o->height);
+				o->point = now;
+				if (o->right != nullptr) { src[top] = o->right; dst[top++] = &now->right; }
+				if (o->left != nullptr) { src[top] = o->left; dst[top++] = &now->left; }
 			}
 			head->next = other.head->next->point;
 			tail->prev = other.tail->prev->point;
@@ -114,27 +115,22 @@ public:
 			root = nullptr;
 		}
 
-		//ȽǷkeyֵͬ            ֪ǲôд
-		bool Issamekey(const Key &x,const Key &y) const
-		{
-			if (!(Compare()(x, y) || Compare()(y, x))) return true;
-			else return false;
-		}
-
 		int max(int a, int b) { return (a > b) ? a : b; }
 		int height(Node *t) const { return t == nullptr ? 0 : t->height; }
 
 		//ѰkeyֵΪxǸڣnullptr
 		Node *find(const Key &x) const
 		{
+			//ÿֻȽһΣ utility.hpp е three_way
 			Node *tmp = root;
-			while (tmp != nullptr && !(Issamekey(x, tmp->data->first)))
+			while (tmp != nullptr)
 			{
-				if (Compare()(x, tmp->data->first)) tmp = tmp->left;
-				else tmp = tmp->right;
+				int c = three_way(Compare(), x, tmp->data->first);
+				if (c < 0) tmp = tmp->left;
+				else if (c > 0) tmp = tmp->right;
+				else break;
 			}
-			if (tmp == nullptr) return nullptr;
-			else return tmp;
+			return tmp;
 		}
 
 		//תʽ
@@ -169,160 +165,90 @@ public:
 			LL(t->right);
 			RR(t);
 		}
-		//!!!
-		void findpre(Node *&ans,Key val)
+		// t ƽⲢ¸߶
+		void balance(Node *&t)
 		{
-			Node *tmp = root;
-			ans = head;
-			while (tmp != nullptr)
+			if (height(t->left) - height(t->right) == 2)
 			{
-				if (Compare()(tmp->data->first, val))
-				{
-					ans = tmp;
-					tmp = tmp->right;
-				}
-				else
-				{
-					tmp = tmp->left;
-				}
+				if (height(t->left->left) >= height(t->left->right)) LL(t); else LR(t);
 			}
+			else if (height(t->right) - height(t->left) == 2)
+			{
+				if (height(t->right->right) >= height(t->right->left)) RR(t); else RL(t);
+			}
+			else t->height = max(height(t->left), height(t->right)) + 1;
 		}
 
-
-		//
-		void insert(const value_type &x)
+		//·Եϵ߶ȲͿͣ
+		void rebalance(Node **path[], int top)
 		{
-			insert(x, root);
+			while (top > 0)
+			{
+				Node *&t = *path[--top];
+				int h = t->height;
+				balance(t);
+				if (t->height == h) break;
+			}
 		}
 
-		void insert(const value_type &x, Node *&t)
+		//
+		void insert(const value_type &x)
 		{
-			if (t == nullptr)
+			Node **path[MAXH];
+			int top = 0;
+			Node **t = &root, *ans = head;
+			while (*t != nullptr)
 			{
-				t = new Node(x);
-				size = size + 1;
-				
-				Node *ans;
-				findpre(ans,x.first);
-				t->next = ans->next;
-				ans->next->prev = t;
-				t->prev = ans;
-				ans->next = t;
+				path[top++] = t;
+				int c = three_way(Compare(), x.first, (*t)->data->first);
+				if (c < 0) t = &(*t)->left;
+				else if (c > 0) { ans = *t; t = &(*t)->right; }
+				else return;
 			}
-			else if (Compare()(x.first, t->data->first))
-			{
-				insert(x, t->left);
-				if (height(t->left) - height(t->right) == 2)
-					if (Compare()(x.first, t->left->data->first)) LL(t); else LR(t);
-			}
-			else if (Compare()(t->data->first, x.first))
-			{
-				insert(x, t->right);
-				if (height(t->right) - height(t->left) == 2)
-					if (Compare()(t->right->data->first, x.first)) RR(t); else RL(t);
-			}
-			t->height = max(height(t->left), height(t->right)) + 1;
+			Node *now = *t = new Node(x);
+			size = size + 1;
+			now->next = ans->next;
+			ans->next->prev = now;
+			now->prev = ans;
+			ans->next = now;
+			rebalance(path, top);
 		}
 
 		//ɾ
 		void remove(const Key &x)
 		{
-			remove(x, root);
-		}
-
-		bool remove(const Key &x,Node *&t)
-		{
-			if (t == nullptr) return true;
-			if (Issamekey(x, t->data->first))
-			{
-				if (t->left == nullptr || t->right == nullptr)
-				{
-					Node *p = t;
-					t = (t->left != nullptr) ? t->left : t->right;
-
-					p->prev->next = p->next; 
-					p->next->prev = p->prev;
-					size--;
-					delete p;
-					return false;
-				}
-				else
-				{
-					Node *tmp = t->right; Node *father = t;
-					//flag == 0 ʾҶ Ϊ
-					int flag = 0;
-					while (tmp->left != nullptr)
-					{
-						flag = 1;
-						father = tmp;
-						tmp = tmp->left;
-					}
-					//t->data->first = tmp->data->first;
-					//t->data->second = tmp->data->second;
-			
-					if (flag == 0)
-					{
-						tmp->left = t->left; t->left = nullptr;
-						t->right = tmp->right; tmp->right = t;
-						int o = tmp->height; tmp->height = t->height; t->height = o;
-						t = tmp;
-						if (remove(t->right->data->first, t->right)) return true;
-						return adjust(t, 1);
-					}
-					else
-					{
-						father->left = t;
-						tmp->left = t->left; t->left = nullptr;
-						Node *op = tmp->right; tmp->right = t->right; t->right = op;
-						int o = tmp->height; tmp->height = t->height; t->height = o;
-						op = t;  t = tmp; tmp = op;
-						if (remove(tmp->data->first, t->right)) return true;
-						return adjust(t, 1);
-					}
-					//ߵĿռ data left right height
-					
-					
-					
-  				}
-			}
-			
-			if (Compare()(x, t->data->first))
+			Node **path[MAXH];
+			int top = 0;
+			Node **t = &root;
+			while (*t != nullptr)
 			{
-				if (remove(x, t->left)) return true;
-				return adjust(t, 0);
+				int c = three_way(Compare(), x, (*t)->data->first);
+				if (c < 0) { path[top++] = t; t = &(*t)->left; }
+				else if (c > 0) { path[top++] = t; t = &(*t)->right; }
+				else break;
 			}
-			else
+			if (*t == nullptr) return;
+			Node *p = *t;
+			if (p->left != nullptr && p->right != nullptr)
 			{
-				if (remove(x, t->right)) return true;
-				return adjust(t, 1);
+				//Ѻ̽ڵŲ p λãָĵʧЧ
+				int k = top;
+				path[top++] = t;
+				Node **s = &p->right;
+				while ((*s)->left != nullptr) { path[top++] = s; s = &(*s)->left; }
+				Node *q = *s;
+				*s = q->right;
+				q->left = p->left; q->right = p->right; q->height = p->height;
+				*t = q;
+				if (k + 1 < top) path[k + 1] = &q->right;
 			}
-		}
+			else *t = (p->left != nullptr) ? p->left : p->right;
 
-		bool adjust(Node *&t, int subTree)
-		{
-			if (subTree) {
-				if (height(t->left) - height(t->right) == 1) return true;
-				if (height(t->right) == height(t->left)) { --t->height; return false; }
-				if (height(t->left->right) > height(t->left->left))
-				{
-					LR(t);
-					return false;
-				}
-				LL(t);
-				if (height(t->right) == height(t->left)) return false; else return true;
-			}
-			else
-			{
-				if (height(t->right) - height(t->left) == 1) return true;
-				if (height(t->right) == height(t->left)) { --t->height;  return false; }
-				if (height(t->right->left) > height(t->right->right))
-				{
-					RL(t);
-					return false;
-				}
-				RR(t);
-				if (height(t->right) == height(t->left)) return false; else return true;
-			}
+			p->prev->next = p->next; 
+			p->next->prev = p->prev;
+			size--;
+			delete p;
+			rebalance(path, top);
 		}
 
 		void dfs(Node *p)
@@ -0,0 +1,704 @@
+/**
+ * implement a container like std::map on a B+ tree
+ */
+#ifndef SJTU_BTREE_MAP_HPP
+#define SJTU_BTREE_MAP_HPP
+
+// only for std::less<T>
+#include <functional>
+#include <cstddef>
+#include <new>
+#include <utility>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "utility.hpp"
+#include "exceptions.hpp"
+
+namespace sjtu {
+
+/**
+ * how an inner node of btree_map picks the child for key:
+ *   leq_count(a, n, key) is the number of keys in a[0, n) not greater than key.
+ * a node is a few cache lines, so a linear scan reads them in order
+ *   and its loop branch is taken the same way until the very end.
+ */
+template<class Key, class Compare>
+struct btree_search {
+	static int leq_count(const Key *a, int n, const Key &key, const Compare &cmp) {
+		int i = 0;
+		while (i < n && !cmp(key, a[i])) ++i;
+		return i;
+	}
+};
+
+#if defined(__SSE2__)
+/**
+ * int keys under std::less: four keys per compare, the answer is the
+ *   number of set lanes since the keys are sorted. no branch on the data.
+ */
+template<>
+struct btree_search<int, std::less<int> > {
+	static int lanes(__m128i m) {
+		return __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(m)));
+	}
+	static int leq_count(const int *a, int n, int key, const std::less<int> &) {
+		__m128i k = _mm_set1_epi32(key);
+		int i = 0, c = n;
+		for (; i + 4 <= n; i += 4)
+			c -= lanes(_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(a + i)), k));
+		for (; i < n; ++i)
+			c -= a[i] > key;
+		return c;
+	}
+};
+#endif
+
+/**
+ * a map with the interface of sjtu::map, kept in a B+ tree.
+ *
+ * every node takes about NodeBytes: inner nodes keep their keys in one
+ *   array and leaves keep their elements in one array, so a lookup costs
+ *   one or two cache misses per level on a tree of height log_B(n).
+ * the leaves are linked, iteration never goes back up the tree.
+ *
+ * unlike sjtu::map, elements move between leaves when nodes split or merge:
+ *   insert and erase invalidate every iterator and reference.
+ */
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>,
+	size_t NodeBytes = 256
+> class btree_map {
+public:
+	/**
+	 * the internal type of data.
+	 * it should have a default constructor, a copy constructor.
+	 * You can use sjtu::map as value_type by typedef.
+	 */
+	typedef pair<const Key, T> value_type;
+
+private:
+	static const int leaf_slots = NodeBytes / sizeof(value_type) < 4 ? 4 : NodeBytes / sizeof(value_type);
+	static const int inner_slots = NodeBytes / (sizeof(Key) + sizeof(void*)) < 4 ? 4 : NodeBytes / (sizeof(Key) + sizeof(void*));
+	static const int MAXH = 64;
+
+	struct node {
+		int n;
+		bool leaf;
+		node(bool leaf): n(0), leaf(leaf) {}
+	};
+	/*
+	   one slot more than leaf_slots, a full leaf takes the new element
+	   first and is split afterwards
+	 */
+	struct leaf_node : node {
+		leaf_node *pre, *nxt;
+		alignas(value_type) unsigned char raw[(leaf_slots + 1) * sizeof(value_type)];
+
+		leaf_node(): node(true), pre(0), nxt(0) {}
+		value_type* val(int i) {
+			return reinterpret_cast<value_type*>(raw) + i;
+		}
+		const Key& key(int i) {
+			return val(i)->first;
+		}
+	};
+	/*
+	   ch[i] holds the keys in [key(i - 1), key(i)), also one spare slot
+	 */
+	struct inner_node : node {
+		node *ch[inner_slots + 2];
+		alignas(Key) unsigned char raw[(inner_slots + 1) * sizeof(Key)];
+
+		inner_node(): node(false) {}
+		Key* key() {
+			return reinterpret_cast<Key*>(raw);
+		}
+	};
+	typedef btree_search<Key, Compare> search;
+
+public:
+	/**
+	 * see BidirectionalIterator at CppReference for help.
+	 *
+	 * if there is anything wrong throw invalid_iterator.
+	 *     like it = map.begin(); --it;
+	 *       or it = map.end(); ++end();
+	 */
+	template<class reference, class pointer>
+	class base_iterator {
+		friend class btree_map;
+		typedef base_iterator<value_type&, value_type*> iterator;
+		typedef base_iterator<const value_type&, const value_type*> const_iterator;
+	private:
+		btree_map *self;
+		leaf_node *data; // null for end()
+		int i;
+
+	public:
+		base_iterator(): self(0), data(0), i(0) {}
+		base_iterator(btree_map *self, leaf_node *data, int i): self(self), data(data), i(i) {}
+		base_iterator(const iterator &other): self(other.self), data(other.data), i(other.i) {}
+		base_iterator(const const_iterator &other): self(other.self), data(other.data), i(other.i) {}
+		base_iterator operator=(const base_iterator &other) {
+			if (this == &other) return *this;
+			self = other.self;
+			data = other.data;
+			i = other.i;
+			return *this;
+		}
+		/**
+		 * iter++
+		 */
+		base_iterator operator++(int) {
+			base_iterator tmp = *this;
+			++(*this);
+			return tmp;
+		}
+		/**
+		 * ++iter
+		 */
+		base_iterator& operator++() {
+			if (!data)
+				throw invalid_iterator();
+			if (++i == data->n) {
+				data = data->nxt;
+				i = 0;
+			}
+			return *this;
+		}
+		/**
+		 * iter--
+		 */
+		base_iterator operator--(int) {
+			base_iterator tmp = *this;
+			--(*this);
+			return tmp;
+		}
+		/**
+		 * --iter
+		 */
+		base_iterator& operator--() {
+			if (!self)
+				throw invalid_iterator();
+			if (i) {
+				--i;
+				return *this;
+			}
+			leaf_node *p = data ? data->pre : self->tail;
+			if (!p)
+				throw invalid_iterator();
+			data = p;
+			i = p->n - 1;
+			return *this;
+		}
+		/**
+		 * some other operator for iterator.
+		 */
+		reference operator*() const {
+			return *data->val(i);
+		}
+		pointer operator->() const noexcept {
+			return data->val(i);
+		}
+		/**
+		 * a operator to check whether two iterators are same (pointing to the same memory).
+		 */
+		bool operator==(const base_iterator &rhs) const {
+			return self == rhs.self && data == rhs.data && i == rhs.i;
+		}
+		bool operator!=(const base_iterator &rhs) const {
+			return !(*this == rhs);
+		}
+	};
+	typedef base_iterator<value_type&, value_type*> iterator;
+	typedef base_iterator<const value_type&, const value_type*> const_iterator;
+	/**
+	 * two constructors
+	 */
+	btree_map(): root(0), head(0), tail(0), sz(0) {}
+	btree_map(const btree_map &o): root(0), head(0), tail(0), sz(0) {
+		copy(o);
+	}
+	/**
+	 * assignment operator
+	 */
+	btree_map& operator=(const btree_map &o) {
+		if (this == &o) {
+			return *this;
+		}
+		clear();
+		copy(o);
+		return *this;
+	}
+	/**
+	 * Destructors
+	 */
+	~btree_map() {
+		clear();
+	}
+	/**
+	 * access specified element with bounds checking
+	 * Returns a reference to the mapped value of the element with key equivalent to key.
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	T& at(const Key &key) {
+		iterator it = find(key);
+		if (!it.data)
+			throw index_out_of_bound();
+		return it->second;
+	}
+	const T& at(const Key &key) const {
+		const_iterator it = find(key);
+		if (!it.data)
+			throw index_out_of_bound();
+		return it->second;
+	}
+	/**
+	 * access specified element
+	 * Returns a reference to the value that is mapped to a key equivalent to key,
+	 *   performing an insertion if such key does not already exist.
+	 */
+	T & operator[](const Key &key) {
+		return insert(value_type(key, T())).first->second;
+	}
+	/**
+	 * behave like at() throw index_out_of_bound if such key does not exist.
+	 */
+	const T & operator[](const Key &key) const {
+		return at(key);
+	}
+	/**
+	 * return a iterator to the beginning
+	 */
+	iterator begin() {
+		return iterator(this, head, 0);
+	}
+	const_iterator cbegin() const {
+		return const_iterator(const_cast<btree_map*>(this), head, 0);
+	}
+	/**
+	 * return a iterator to the end
+	 * in fact, it returns past-the-end.
+	 */
+	iterator end() {
+		return iterator(this, 0, 0);
+	}
+	const_iterator cend() const {
+		return const_iterator(const_cast<btree_map*>(this), 0, 0);
+	}
+	/**
+	 * checks whether the container is empty
+	 * return true if empty, otherwise false.
+	 */
+	bool empty() const {
+		return !sz;
+	}
+	/**
+	 * returns the number of elements.
+	 */
+	size_t size() const {
+		return sz;
+	}
+	/**
+	 * clears the contents
+	 */
+	void clear() {
+		if (root) destroy(root);
+		root = 0;
+		head = tail = 0;
+		sz = 0;
+	}
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<iterator, bool> insert(const value_type &value) {
+		if (!root) {
+			leaf_node *x = new leaf_node();
+			new (x->val(0)) value_type(value);
+			x->n = 1;
+			root = head = tail = x;
+			sz = 1;
+			return pair<iterator, bool>(iterator(this, x, 0), true);
+		}
+		inner_node *path[MAXH];
+		int way[MAXH], h = descend(value.first, path, way);
+		leaf_node *x = static_cast<leaf_node*>(h ? path[h - 1]->ch[way[h - 1]] : root);
+		int i = lower_index(x, value.first);
+		if (i < x->n && !cmp(value.first, x->key(i)))
+			return pair<iterator, bool>(iterator(this, x, i), false);
+		shift_right(x->val(0), x->n, i);
+		new (x->val(i)) value_type(value);
+		++x->n;
+		++sz;
+		if (x->n <= leaf_slots)
+			return pair<iterator, bool>(iterator(this, x, i), true);
+		leaf_node *y = split(x);
+		node *o = y;
+		for (;;) {
+			if (!h) {
+				inner_node *p = new inner_node();
+				new (p->key()) Key(y->key(0));
+				p->ch[0] = root;
+				p->ch[1] = y;
+				p->n = 1;
+				root = p;
+				break;
+			}
+			inner_node *p = path[--h];
+			int j = way[h];
+			shift_right(p->key(), p->n, j);
+			shift_children(p, j + 1);
+			if (o->leaf) {
+				new (p->key() + j) Key(static_cast<leaf_node*>(o)->key(0));
+			} else {
+				// the middle key of the split inner node moves up
+				inner_node *q = static_cast<inner_node*>(p->ch[j]);
+				relocate(q->key() + q->n, p->key() + j);
+			}
+			p->ch[j + 1] = o;
+			if (++p->n <= inner_slots)
+				break;
+			o = split(p);
+			if (!h) {
+				inner_node *r = new inner_node();
+				relocate(p->key() + p->n, r->key());
+				r->ch[0] = p;
+				r->ch[1] = o;
+				r->n = 1;
+				root = r;
+				break;
+			}
+		}
+		if (i < x->n)
+			return pair<iterator, bool>(iterator(this, x, i), true);
+		return pair<iterator, bool>(iterator(this, y, i - x->n), true);
+	}
+	/**
+	 * erase the element at pos.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(iterator pos) {
+		if (pos.self != this || !pos.data) throw invalid_iterator();
+		inner_node *path[MAXH];
+		int way[MAXH], h = descend(pos->first, path, way);
+		leaf_node *x = static_cast<leaf_node*>(h ? path[h - 1]->ch[way[h - 1]] : root);
+		if (x != pos.data || pos.i >= x->n) throw invalid_iterator();
+		x->val(pos.i)->~value_type();
+		shift_left(x->val(0), x->n, pos.i);
+		--x->n;
+		--sz;
+		node *o = x;
+		while (h && o->n < min_fill(o)) {
+			--h;
+			fix(path[h], way[h]);
+			o = path[h];
+		}
+		if (!root->n) {
+			node *r = root;
+			if (r->leaf) {
+				root = 0;
+				head = tail = 0;
+			} else {
+				root = static_cast<inner_node*>(r)->ch[0];
+			}
+			delete_node(r);
+		}
+	}
+	/**
+	 * Returns the number of elements with key
+	 *   that compares equivalent to the specified argument,
+	 *   which is either 1 or 0
+	 *     since this container does not allow duplicates.
+	 * The default method of check the equivalence is !(a < b || b > a)
+	 */
+	size_t count(const Key &key) const {
+		return size_t(find(key).data ? 1 : 0);
+	}
+	/**
+	 * Finds an element with key equivalent to key.
+	 * key value of the element to search for.
+	 * Iterator to an element with key equivalent to key.
+	 *   If no such element is found, past-the-end (see end()) iterator is returned.
+	 */
+	iterator find(const Key &key) {
+		if (!root) return end();
+		leaf_node *x = leaf_of(key);
+		int i = lower_index(x, key);
+		if (i == x->n || cmp(key, x->key(i))) return end();
+		return iterator(this, x, i);
+	}
+	const_iterator find(const Key &key) const {
+		return const_cast<btree_map*>(this)->find(key);
+	}
+	/**
+	 * Returns an iterator to the first element whose key is not less than key,
+	 *   or end() if there is no such element.
+	 */
+	iterator lower_bound(const Key &key) {
+		if (!root) return end();
+		leaf_node *x = leaf_of(key);
+		return at_index(x, lower_index(x, key));
+	}
+	const_iterator lower_bound(const Key &key) const {
+		return const_cast<btree_map*>(this)->lower_bound(key);
+	}
+	/**
+	 * Returns an iterator to the first element whose key is greater than key,
+	 *   or end() if there is no such element.
+	 */
+	iterator upper_bound(const Key &key) {
+		if (!root) return end();
+		leaf_node *x = leaf_of(key);
+		int i = 0;
+		while (i < x->n && !cmp(key, x->key(i))) ++i;
+		return at_index(x, i);
+	}
+	const_iterator upper_bound(const Key &key) const {
+		return const_cast<btree_map*>(this)->upper_bound(key);
+	}
+
+private:
+	node *root;
+	leaf_node *head, *tail;
+	size_t sz;
+	Compare cmp;
+
+	/*
+	   open a hole at pos in a[0, n)
+	 */
+	template<class U>
+	static void shift_right(U *a, int n, int pos) {
+		for (int i = n; i > pos; --i)
+			relocate(a + i - 1, a + i);
+	}
+	/*
+	   close the hole at pos in a[0, n), a[pos] is already destroyed
+	 */
+	template<class U>
+	static void shift_left(U *a, int n, int pos) {
+		for (int i = pos; i + 1 < n; ++i)
+			relocate(a + i + 1, a + i);
+	}
+	static void shift_children(inner_node *p, int pos) {
+		for (int i = p->n + 1; i > pos; --i)
+			p->ch[i] = p->ch[i - 1];
+	}
+	static int min_fill(node *o) {
+		return o->leaf ? leaf_slots / 2 : inner_slots / 2;
+	}
+
+	int lower_index(leaf_node *x, const Key &key) const {
+		int i = 0;
+		while (i < x->n && cmp(x->key(i), key)) ++i;
+		return i;
+	}
+	leaf_node* leaf_of(const Key &key) const {
+		node *o = root;
+		while (!o->leaf) {
+			inner_node *p = static_cast<inner_node*>(o);
+			o = p->ch[search::leq_count(p->key(), p->n, key, cmp)];
+		}
+		return static_cast<leaf_node*>(o);
+	}
+	/*
+	   walk down to the leaf that should hold key,
+	   path[k]->ch[way[k]] is the node at depth k + 1, returns the depth of the leaf
+	 */
+	int descend(const Key &key, inner_node **path, int *way) const {
+		int h = 0;
+		node *o = root;
+		while (!o->leaf) {
+			inner_node *p = static_cast<inner_node*>(o);
+			path[h] = p;
+			way[h] = search::leq_count(p->key(), p->n, key, cmp);
+			o = p->ch[way[h++]];
+		}
+		return h;
+	}
+	iterator at_index(leaf_node *x, int i) {
+		if (i == x->n) return iterator(this, x->nxt, 0);
+		return iterator(this, x, i);
+	}
+
+	/*
+	   move the upper half of an overfull leaf to a new leaf after it
+	 */
+	leaf_node* split(leaf_node *x) {
+		leaf_node *y = new leaf_node();
+		int m = x->n / 2;
+		for (int i = m; i < x->n; ++i)
+			relocate(x->val(i), y->val(i - m));
+		y->n = x->n - m;
+		x->n = m;
+		y->nxt = x->nxt;
+		y->pre = x;
+		if (x->nxt) x->nxt->pre = y;
+		else tail = y;
+		x->nxt = y;
+		return y;
+	}
+	/*
+	   move the keys after the middle one of an overfull inner node to a
+	   new node, the middle key stays constructed at key()[p->n] for the caller
+	 */
+	inner_node* split(inner_node *p) {
+		inner_node *q = new inner_node();
+		int m = p->n / 2;
+		for (int i = m + 1; i < p->n; ++i)
+			relocate(p->key() + i, q->key() + i - m - 1);
+		for (int i = m + 1; i <= p->n; ++i)
+			q->ch[i - m - 1] = p->ch[i];
+		q->n = p->n - m - 1;
+		p->n = m;
+		return q;
+	}
+	/*
+	   remove key k and child k + 1 of p, key k is already destroyed
+	 */
+	static void drop(inner_node *p, int k) {
+		shift_left(p->key(), p->n, k);
+		for (int i = k + 1; i < p->n; ++i)
+			p->ch[i] = p->ch[i + 1];
+		--p->n;
+	}
+	/*
+	   the child j of p is under min_fill: borrow from a sibling that has
+	   more than it needs, otherwise merge with a sibling
+	 */
+	void fix(inner_node *p, int j) {
+		node *o = p->ch[j];
+		node *l = j ? p->ch[j - 1] : 0;
+		node *r = j < p->n ? p->ch[j + 1] : 0;
+		if (l && l->n > min_fill(l)) {
+			if (o->leaf) borrow_left(static_cast<leaf_node*>(l), static_cast<leaf_node*>(o), p->key() + j - 1);
+			else borrow_left(static_cast<inner_node*>(l), static_cast<inner_node*>(o), p->key() + j - 1);
+		} else if (r && r->n > min_fill(r)) {
+			if (o->leaf) borrow_right(static_cast<leaf_node*>(o), static_cast<leaf_node*>(r), p->key() + j);
+			else borrow_right(static_cast<inner_node*>(o), static_cast<inner_node*>(r), p->key() + j);
+		} else {
+			if (!l) l = o, o = r, ++j;
+			if (o->leaf) merge(static_cast<leaf_node*>(l), static_cast<leaf_node*>(o), p->key() + j - 1);
+			else merge(static_cast<inner_node*>(l), static_cast<inner_node*>(o), p->key() + j - 1);
+			drop(p, j - 1);
+		}
+	}
+	void borrow_left(leaf_node *l, leaf_node *o, Key *sep) {
+		shift_right(o->val(0), o->n, 0);
+		relocate(l->val(--l->n), o->val(0));
+		++o->n;
+		sep->~Key();
+		new (sep) Key(o->key(0));
+	}
+	void borrow_right(leaf_node *o, leaf_node *r, Key *sep) {
+		relocate(r->val(0), o->val(o->n++));
+		shift_left(r->val(0), r->n--, 0);
+		sep->~Key();
+		new (sep) Key(r->key(0));
+	}
+	/*
+	   r goes into l and is freed, sep is destroyed
+	 */
+	void merge(leaf_node *l, leaf_node *r, Key *sep) {
+		for (int i = 0; i < r->n; ++i)
+			relocate(r->val(i), l->val(l->n + i));
+		l->n += r->n;
+		l->nxt = r->nxt;
+		if (r->nxt) r->nxt->pre = l;
+		else tail = l;
+		sep->~Key();
+		delete r;
+	}
+	void borrow_left(inner_node *l, inner_node *o, Key *sep) {
+		shift_right(o->key(), o->n, 0);
+		shift_children(o, 0);
+		relocate(sep, o->key());
+		o->ch[0] = l->ch[l->n];
+		++o->n;
+		relocate(l->key() + --l->n, sep);
+	}
+	void borrow_right(inner_node *o, inner_node *r, Key *sep) {
+		relocate(sep, o->key() + o->n);
+		o->ch[++o->n] = r->ch[0];
+		relocate(r->key(), sep);
+		shift_left(r->key(), r->n, 0);
+		for (int i = 0; i < r->n; ++i)
+			r->ch[i] = r->ch[i + 1];
+		--r->n;
+	}
+	void merge(inner_node *l, inner_node *r, Key *sep) {
+		relocate(sep, l->key() + l->n);
+		for (int i = 0; i < r->n; ++i)
+			relocate(r->key() + i, l->key() + l->n + 1 + i);
+		for (int i = 0; i <= r->n; ++i)
+			l->ch[l->n + 1 + i] = r->ch[i];
+		l->n += r->n + 1;
+		r->n = 0;
+		delete r;
+	}
+
+	/*
+	   the tree is log_B(n) high, recursion is shallow here
+	 */
+	void destroy(node *o) {
+		if (!o->leaf) {
+			inner_node *p = static_cast<inner_node*>(o);
+			for (int i = 0; i <= p->n; ++i)
+				destroy(p->ch[i]);
+		}
+		delete_node(o);
+	}
+	void delete_node(node *o) {
+		if (o->leaf) {
+			leaf_node *x = static_cast<leaf_node*>(o);
+			for (int i = 0; i < x->n; ++i)
+				x->val(i)->~value_type();
+			delete x;
+		} else {
+			inner_node *p = static_cast<inner_node*>(o);
+			for (int i = 0; i < p->n; ++i)
+				p->key()[i].~Key();
+			delete p;
+		}
+	}
+	/*
+	   same shape as o, the leaves are linked in the order they are made
+	 */
+	node* clone(node *o, leaf_node *&last) {
+		if (o->leaf) {
+			leaf_node *x = static_cast<leaf_node*>(o), *y = new leaf_node();
+			for (int i = 0; i < x->n; ++i)
+				new (y->val(i)) value_type(*x->val(i));
+			y->n = x->n;
+			y->pre = last;
+			if (last) last->nxt = y;
+			else head = y;
+			last = y;
+			return y;
+		}
+		inner_node *p = static_cast<inner_node*>(o), *q = new inner_node();
+		for (int i = 0; i < p->n; ++i)
+			new (q->key() + i) Key(p->key()[i]);
+		q->n = p->n;
+		for (int i = 0; i <= p->n; ++i)
+			q->ch[i] = clone(p->ch[i], last);
+		return q;
+	}
+	void copy(const btree_map &o) {
+		if (!o.root) return;
+		leaf_node *last = 0;
+		root = clone(o.root, last);
+		tail = last;
+		sz = o.sz;
+	}
+};
+
+}
+
+#endif
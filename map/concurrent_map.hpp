@@ -0,0 +1,439 @@
+/**
+ * implement an ordered map for many threads
+ */
+#ifndef SJTU_CONCURRENT_MAP_HPP
+#define SJTU_CONCURRENT_MAP_HPP
+
+// only for std::less<T>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <new>
+#include <utility>
+#include "utility.hpp"
+#include "exceptions.hpp"
+#include "epoch.hpp"
+
+namespace sjtu {
+
+/**
+ * a lock-free skip list: insert, erase, find and iteration may all run
+ *   at the same time from any number of threads.
+ *
+ * every level is a sorted list whose links carry a mark in the low bit
+ *   (Harris, Michael): erase marks the links of a node top down, the mark
+ *   on level 0 is the moment the element leaves the map, and any later
+ *   search unlinks the marked node on its way. a search that does not
+ *   change the map writes nothing shared, so readers scale with the cores.
+ * unlinked nodes go through epoch::retire, a node is only freed when no
+ *   thread can still be looking at it. the node also counts its inserter
+ *   and its eraser, and whichever of them finishes last retires it, so an
+ *   insert still linking the upper levels never links a retired node.
+ *
+ * elements are read only once inserted: there is no operator[] or
+ *   insert_or_assign, and at() returns a copy.
+ * iterators pin the thread (see epoch) and are weakly consistent: they
+ *   never fail, never see an element twice, see every element that was
+ *   there for the whole walk, and may or may not see the ones inserted or
+ *   erased meanwhile. an iterator belongs to the thread that made it.
+ * size() is exact only while nobody changes the map.
+ */
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>
+> class concurrent_map {
+public:
+	typedef pair<const Key, T> value_type;
+
+private:
+	static const int max_level = 32;
+
+	struct node {
+		int h;
+		std::atomic<int> refs; // the inserter and the eraser
+		alignas(value_type) unsigned char raw[sizeof(value_type)];
+
+		value_type& val() {
+			return *reinterpret_cast<value_type*>(raw);
+		}
+		const Key& key() {
+			return val().first;
+		}
+		/*
+		   the h links sit right after the node, in the same block
+		 */
+		static size_t links() {
+			const size_t a = alignof(std::atomic<uintptr_t>);
+			return (sizeof(node) + a - 1) / a * a;
+		}
+		std::atomic<uintptr_t>& next(int l) {
+			return reinterpret_cast<std::atomic<uintptr_t>*>(reinterpret_cast<char*>(this) + links())[l];
+		}
+		node* succ(int l) {
+			return ptr(next(l).load(std::memory_order_acquire));
+		}
+		static node* make(int h) {
+			node *x = static_cast<node*>(::operator new(links() + h * sizeof(std::atomic<uintptr_t>)));
+			x->h = h;
+			new (&x->refs) std::atomic<int>(2);
+			for (int l = 0; l < h; ++l)
+				new (&x->next(l)) std::atomic<uintptr_t>(0);
+			return x;
+		}
+		static void destroy(void *p) {
+			node *x = static_cast<node*>(p);
+			x->val().~value_type();
+			::operator delete(p);
+		}
+	};
+
+	static node* ptr(uintptr_t v) {
+		return reinterpret_cast<node*>(v & ~uintptr_t(1));
+	}
+	static bool marked(uintptr_t v) {
+		return v & 1;
+	}
+
+public:
+	/**
+	 * see BidirectionalIterator at CppReference for help.
+	 *   only forward moves are supported: a skip list has no back links.
+	 *
+	 * if there is anything wrong throw invalid_iterator.
+	 *     like it = map.end(); ++end();
+	 */
+	class const_iterator {
+		friend class concurrent_map;
+	private:
+		epoch::guard g;
+		node *p; // 0 for end()
+
+	public:
+		const_iterator(): p(0) {}
+		explicit const_iterator(node *p): p(p) {}
+		/**
+		 * iter++
+		 */
+		const_iterator operator++(int) {
+			const_iterator tmp = *this;
+			++(*this);
+			return tmp;
+		}
+		/**
+		 * ++iter
+		 */
+		const_iterator& operator++() {
+			if (!p)
+				throw invalid_iterator();
+			p = first_live(p->succ(0));
+			return *this;
+		}
+		const value_type& operator*() const {
+			return p->val();
+		}
+		const value_type* operator->() const noexcept {
+			return &p->val();
+		}
+		/**
+		 * a operator to check whether two iterators are same (pointing to the same memory).
+		 */
+		bool operator==(const const_iterator &rhs) const {
+			return p == rhs.p;
+		}
+		bool operator!=(const const_iterator &rhs) const {
+			return p != rhs.p;
+		}
+	};
+	typedef const_iterator iterator;
+
+	concurrent_map(): head(node::make(max_level)), top(1), n(0) {}
+	/**
+	 * a weakly consistent copy of o, which may be in use meanwhile.
+	 */
+	concurrent_map(const concurrent_map &o): head(node::make(max_level)), top(1), n(0), cmp(o.cmp) {
+		for (const_iterator it = o.cbegin(); it != o.cend(); ++it)
+			insert(*it);
+	}
+	/**
+	 * not atomic: the map may not be in use by others while it is assigned.
+	 */
+	concurrent_map& operator=(const concurrent_map &o) {
+		if (this == &o) {
+			return *this;
+		}
+		clear();
+		for (const_iterator it = o.cbegin(); it != o.cend(); ++it)
+			insert(*it);
+		return *this;
+	}
+	/**
+	 * no other thread may use the map any more. erased nodes already
+	 *   handed to epoch are freed there.
+	 */
+	~concurrent_map() {
+		for (node *x = head->succ(0), *t; x; x = t) {
+			t = x->succ(0);
+			node::destroy(x);
+		}
+		::operator delete(head);
+	}
+	/**
+	 * a copy of the value of key, which may be erased right after.
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	T at(const Key &key) const {
+		epoch::guard g;
+		node *x = search(key);
+		if (!x)
+			throw index_out_of_bound();
+		return x->val().second;
+	}
+	const_iterator begin() const {
+		const_iterator it;
+		it.p = first_live(head->succ(0));
+		return it;
+	}
+	const_iterator cbegin() const {
+		return begin();
+	}
+	const_iterator end() const {
+		return const_iterator();
+	}
+	const_iterator cend() const {
+		return end();
+	}
+	bool empty() const {
+		return size() == 0;
+	}
+	size_t size() const {
+		long long c = n.load(std::memory_order_relaxed);
+		return c < 0 ? 0 : size_t(c);
+	}
+	/**
+	 * erase everything there was when it started.
+	 */
+	void clear() {
+		epoch::guard g;
+		for (node *x = first_live(head->succ(0)); x; x = first_live(x->succ(0)))
+			erase(x->key());
+	}
+	size_t count(const Key &key) const {
+		epoch::guard g;
+		return size_t(search(key) ? 1 : 0);
+	}
+	/**
+	 * Finds an element with key equivalent to key.
+	 *   If no such element is found, past-the-end (see end()) iterator is returned.
+	 */
+	const_iterator find(const Key &key) const {
+		const_iterator it;
+		it.p = search(key);
+		return it;
+	}
+	/**
+	 * Returns an iterator to the first element whose key is not less than key,
+	 *   or end() if there is no such element.
+	 */
+	const_iterator lower_bound(const Key &key) const {
+		const_iterator it;
+		it.p = first_live(bound(key));
+		return it;
+	}
+	/**
+	 * Returns an iterator to the first element whose key is greater than key,
+	 *   or end() if there is no such element.
+	 */
+	const_iterator upper_bound(const Key &key) const {
+		const_iterator it;
+		node *x = first_live(bound(key));
+		if (x && !cmp(key, x->key()))
+			x = first_live(x->succ(0));
+		it.p = x;
+		return it;
+	}
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<const_iterator, bool> insert(const value_type &value) {
+		const_iterator it;
+		int h = level();
+		raise(h);
+		node *preds[max_level], *succs[max_level];
+		node *x = 0;
+		for (;;) {
+			if (locate(value.first, preds, succs)) {
+				if (x) node::destroy(x); // never published
+				it.p = succs[0];
+				return pair<const_iterator, bool>(it, false);
+			}
+			if (!x) {
+				x = node::make(h);
+				try {
+					new (x->raw) value_type(value);
+				} catch (...) {
+					::operator delete(x);
+					throw;
+				}
+			}
+			for (int l = 0; l < h; ++l)
+				x->next(l).store(uintptr_t(succs[l]), std::memory_order_relaxed);
+			uintptr_t e = uintptr_t(succs[0]);
+			if (preds[0]->next(0).compare_exchange_strong(e, uintptr_t(x)))
+				break;
+		}
+		n.fetch_add(1, std::memory_order_relaxed);
+		it.p = x;
+		link_upper(x, preds, succs);
+		return pair<const_iterator, bool>(it, true);
+	}
+	/**
+	 * erase the element with key, return the number of elements erased (0 or 1).
+	 *   when two threads erase the same key only one of them gets 1.
+	 */
+	size_t erase(const Key &key) {
+		epoch::guard g;
+		node *preds[max_level], *succs[max_level];
+		if (!locate(key, preds, succs))
+			return 0;
+		node *x = succs[0];
+		for (int l = x->h - 1; l > 0; --l)
+			x->next(l).fetch_or(1);
+		uintptr_t v = x->next(0).load();
+		do {
+			if (marked(v)) return 0;
+		} while (!x->next(0).compare_exchange_weak(v, v | 1));
+		n.fetch_sub(1, std::memory_order_relaxed);
+		locate(key, preds, succs); // unlinks x on every level
+		drop(x);
+		return 1;
+	}
+	/**
+	 * erase the element at pos, if it is still there.
+	 *
+	 * throw if pos == this->end()
+	 */
+	void erase(const_iterator pos) {
+		if (!pos.p) throw invalid_iterator();
+		erase(pos->first);
+	}
+
+private:
+	node *head;
+	std::atomic<int> top;     // levels in use, only grows
+	std::atomic<long long> n;
+	Compare cmp;
+
+	/*
+	   the height of a new node, one more level with probability 1/2
+	 */
+	static int level() {
+		static thread_local unsigned long long s = 0;
+		if (!s) s = reinterpret_cast<uintptr_t>(&s) * 0x9e3779b97f4a7c15ULL | 1;
+		s ^= s << 13;
+		s ^= s >> 7;
+		s ^= s << 17;
+		int h = 1 + __builtin_ctzll(s | (1ULL << (max_level - 1)));
+		return h;
+	}
+	void raise(int h) {
+		int t = top.load(std::memory_order_relaxed);
+		while (t < h && !top.compare_exchange_weak(t, h));
+	}
+	static node* first_live(node *x) {
+		while (x && marked(x->next(0).load(std::memory_order_acquire)))
+			x = x->succ(0);
+		return x;
+	}
+	/*
+	   the first node on level 0 whose key is not less than key, marked ones
+	   are stepped over but not unlinked: readers write nothing
+	 */
+	node* bound(const Key &key) const {
+		node *pred = head, *cur = 0;
+		for (int l = top.load(std::memory_order_acquire) - 1; l >= 0; --l) {
+			cur = pred->succ(l);
+			while (cur) {
+				uintptr_t s = cur->next(l).load(std::memory_order_acquire);
+				if (!marked(s) && !cmp(cur->key(), key))
+					break;
+				if (!marked(s))
+					pred = cur;
+				cur = ptr(s);
+			}
+		}
+		return cur;
+	}
+	node* search(const Key &key) const {
+		node *x = bound(key);
+		if (x && !cmp(key, x->key()) && !marked(x->next(0).load(std::memory_order_acquire)))
+			return x;
+		return 0;
+	}
+	/*
+	   fill in where key goes on each level in use, unlinking the marked
+	   nodes met on the way; true if an unmarked node holds key
+	 */
+	bool locate(const Key &key, node **preds, node **succs) {
+		int t = top.load();
+	retry:
+		node *pred = head;
+		for (int l = t - 1; l >= 0; --l) {
+			node *cur = pred->succ(l);
+			for (;;) {
+				if (!cur) break;
+				uintptr_t s = cur->next(l).load(std::memory_order_acquire);
+				if (marked(s)) {
+					uintptr_t e = uintptr_t(cur);
+					if (!pred->next(l).compare_exchange_strong(e, s & ~uintptr_t(1)))
+						goto retry;
+					cur = ptr(s);
+					continue;
+				}
+				if (!cmp(cur->key(), key))
+					break;
+				pred = cur;
+				cur = ptr(s);
+			}
+			preds[l] = pred;
+			succs[l] = cur;
+		}
+		return succs[0] && !cmp(key, succs[0]->key());
+	}
+	/*
+	   link x (already on level 0) into its upper levels, giving up as soon
+	   as an eraser has marked it
+	 */
+	void link_upper(node *x, node **preds, node **succs) {
+		for (int l = 1; l < x->h; ++l) {
+			for (;;) {
+				uintptr_t v = x->next(l).load();
+				while (!marked(v) && ptr(v) != succs[l] && !x->next(l).compare_exchange_weak(v, uintptr_t(succs[l])));
+				if (marked(v))
+					goto done;
+				uintptr_t e = uintptr_t(succs[l]);
+				if (preds[l]->next(l).compare_exchange_strong(e, uintptr_t(x)))
+					break;
+				if (!locate(x->key(), preds, succs) || succs[0] != x)
+					goto done;
+			}
+		}
+	done:
+		// an eraser may have swept before one of the links above was made
+		if (marked(x->next(0).load()))
+			locate(x->key(), preds, succs);
+		drop(x);
+	}
+	void drop(node *x) {
+		if (x->refs.fetch_sub(1) == 1)
+			epoch::retire(x, &node::destroy);
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,172 @@
+// multimap and multiset against std::multimap and std::multiset
+
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <vector>
+#include <iterator>
+#include "map.hpp"
+#include "multiset.hpp"
+
+long long aa = 13131, bb = 5353, MOD = (long long)(1e9 + 7), now = 1;
+int rand() {
+	for (int i = 1; i < 3; i++)
+		now = (now * aa + bb) % MOD;
+	return now;
+}
+
+bool failed = false;
+void check(bool ok, const char *what) {
+	if (!ok && !failed) {
+		std::cout << "wrong: " << what << std::endl;
+		failed = true;
+	}
+}
+void result() {
+	std::cout << (failed ? "fail" : "ok") << std::endl;
+	failed = false;
+}
+
+typedef sjtu::multimap<int, int> multimap;
+
+template<class It>
+int steps(It a, It b) {
+	int n = 0;
+	for (; a != b; ++a)
+		++n;
+	return n;
+}
+template<class It, class Jt>
+bool same(It a, It ae, Jt b, Jt be) {
+	for (; a != ae && b != be; ++a, ++b)
+		if (a->first != b->first || a->second != b->second)
+			return false;
+	return a == ae && b == be;
+}
+
+void test_runs() {
+	puts("Test: erase inside a run of equal keys");
+	multimap m;
+	for (int i = 0; i < 6; ++i)
+		m.insert(multimap::value_type(1, i));
+	m.erase(m.begin() + 2, m.begin() + 4);
+	for (auto &kv : m)
+		std::cout << kv.second << ' ';
+	puts("");
+	m.erase(m.begin() + 1, m.end() - 1);
+	for (auto &kv : m)
+		std::cout << kv.second << ' ';
+	puts("");
+	sjtu::multiset<int> s;
+	for (int i = 0; i < 30; ++i)
+		s.insert(i % 3);
+	auto a = s.begin(), b = s.begin();
+	for (int i = 0; i < 5; ++i) ++a;
+	for (int i = 0; i < 17; ++i) ++b;
+	s.erase(a, b);
+	std::cout << s.size() << ' ' << s.count(0) << ' ' << s.count(1) << ' ' << s.count(2) << std::endl;
+}
+
+void test_find_many() {
+	puts("Test: find_many in a multimap");
+	multimap m;
+	for (int i = 0; i < 100; ++i)
+		m.insert(multimap::value_type(i % 4, i));
+	int keys[] = {0, 1, 2, 3, 4, 1};
+	multimap::iterator out[6];
+	m.find_many(keys, keys + 6, out);
+	for (int i = 0; i < 6; ++i) {
+		check(out[i] == m.find(keys[i]), "find_many against find");
+		if (out[i] == m.end()) std::cout << "end ";
+		else std::cout << out[i]->second << ' ';
+	}
+	puts("");
+	result();
+}
+
+void test_random() {
+	puts("Test: random multimap");
+	multimap m;
+	std::multimap<int, int> s;
+	long long hash = 0;
+	for (int step = 0; step < 50000; ++step) {
+		int op = rand() % 10, key = rand() % 300;
+		if (op < 5) {
+			auto it = m.insert(multimap::value_type(key, step)).first;
+			s.insert(std::make_pair(key, step));
+			check(it->first == key && it->second == step, "insert");
+		} else if (op < 6) {
+			check(m.erase(key) == s.erase(key), "erase key");
+		} else if (op < 7 && !s.empty()) {
+			int a = rand() % s.size(), b = a + rand() % 4;
+			if (b > (int)s.size()) b = s.size();
+			auto i = s.begin(), j = s.begin();
+			std::advance(i, a);
+			std::advance(j, b);
+			s.erase(i, j);
+			m.erase(m.begin() + a, m.begin() + b);
+		} else if (op < 8 && !s.empty()) {
+			int a = rand() % s.size();
+			auto i = s.begin();
+			std::advance(i, a);
+			s.erase(i);
+			m.erase(m.begin() + a);
+		} else {
+			check(m.count(key) == s.count(key), "count");
+			auto r = m.equal_range(key);
+			auto q = s.equal_range(key);
+			check(same(r.first, r.second, q.first, q.second), "equal_range");
+			auto f = m.find(key);
+			auto g = s.find(key);
+			check((f == m.end()) == (g == s.end()), "find");
+			if (g != s.end()) {
+				check(f->second == g->second, "find takes the first");
+				hash = (hash * 31 + f->second) % MOD;
+			}
+			check(m.index_of(key) == (int)std::distance(s.begin(), s.lower_bound(key)), "index_of");
+		}
+		check(m.size() == s.size(), "size");
+	}
+	check(same(m.begin(), m.end(), s.begin(), s.end()), "order");
+	multimap c(m);
+	check(same(c.begin(), c.end(), s.begin(), s.end()), "copy");
+	std::cout << "size:" << s.size() << " hash:" << hash << std::endl;
+	result();
+}
+
+void test_multiset() {
+	puts("Test: random multiset");
+	sjtu::multiset<int> m;
+	std::multiset<int> s;
+	for (int step = 0; step < 30000; ++step) {
+		int op = rand() % 6, key = rand() % 200;
+		if (op < 3) {
+			m.insert(key);
+			s.insert(key);
+		} else if (op < 4) {
+			check(m.erase(key) == s.erase(key), "erase key");
+		} else {
+			check(m.count(key) == s.count(key), "count");
+			auto l = m.lower_bound(key);
+			auto u = m.upper_bound(key);
+			check(steps(m.begin(), l) == std::distance(s.begin(), s.lower_bound(key)), "lower_bound");
+			check(steps(l, u) == (int)s.count(key), "upper_bound");
+			check(m.index_of(key) == steps(m.begin(), l), "index_of");
+		}
+	}
+	std::vector<int> a, b(s.begin(), s.end());
+	for (auto it = m.begin(); it != m.end(); ++it)
+		a.push_back(*it);
+	check(a == b, "order");
+	std::cout << "size:" << s.size() << std::endl;
+	result();
+}
+
+int main() {
+	test_runs();
+	test_find_many();
+	test_random();
+	test_multiset();
+	return 0;
+}
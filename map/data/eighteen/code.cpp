@@ -0,0 +1,200 @@
+// split, join, merge_from and the set operations against std::map
+
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <vector>
+#include "map.hpp"
+
+long long aa = 13131, bb = 5353, MOD = (long long)(1e9 + 7), now = 1;
+int rand() {
+	for (int i = 1; i < 3; i++)
+		now = (now * aa + bb) % MOD;
+	return now;
+}
+
+bool failed = false;
+void check(bool ok, const char *what) {
+	if (!ok && !failed) {
+		std::cout << "wrong: " << what << std::endl;
+		failed = true;
+	}
+}
+void result() {
+	std::cout << (failed ? "fail" : "ok") << std::endl;
+	failed = false;
+}
+
+struct sum {
+	typedef long long value_type;
+	static value_type identity() {
+		return 0;
+	}
+	static value_type of(const sjtu::pair<const int, int> &e) {
+		return e.second;
+	}
+	static value_type combine(const value_type &l, const value_type &r) {
+		return l + r;
+	}
+};
+
+typedef sjtu::map<int, int, std::less<int>, sjtu::treap_balance, sum> map;
+typedef std::map<int, int> model;
+
+/*
+   sizes, parents and sums down the tree, the thread both ways,
+   and index_of of every key around the elements
+ */
+template<class Node>
+int walk(const Node *o, const Node *fa) {
+	if (!o) return 0;
+	check(o->fa == fa, "parent");
+	int n = walk(o->lc, o) + walk(o->rc, o) + 1;
+	check(o->sz == n, "size of a subtree");
+	check(sjtu::augment_field<sum>::get(o) == sjtu::augment_field<sum>::get(o->lc) + o->val->second + sjtu::augment_field<sum>::get(o->rc), "sum of a subtree");
+	return n;
+}
+void same(map &m, const model &s, int range) {
+	check(m.size() == s.size() && m.empty() == s.empty(), "size");
+	check(walk(m.tree_root(), (const map::node*)0) == (int)s.size(), "size of the tree");
+	long long tot = 0;
+	auto it = m.begin();
+	for (auto &kv : s) {
+		check(it != m.end() && it->first == kv.first && it->second == kv.second, "order");
+		tot += kv.second;
+		++it;
+	}
+	check(it == m.end(), "end");
+	check(m.reduce() == tot, "reduce");
+	it = m.end();
+	for (auto jt = s.rbegin(); jt != s.rend(); ++jt) {
+		--it;
+		check(it->first == jt->first, "backwards");
+	}
+	check(it == m.begin(), "begin");
+	int less = 0;
+	for (int key = -1; key <= range; ++key) {
+		check(m.index_of(key) == less, "index_of");
+		bool in = s.count(key);
+		check(m.count(key) == size_t(in), "count");
+		if (in) check(m.begin() + less == m.find(key), "begin() + index_of");
+		less += in;
+	}
+}
+
+/*
+   n keys in [lo, hi) with a step, the values tell the two sides apart
+ */
+void fill(map &m, model &s, int n, int lo, int hi, int step, int tag) {
+	for (int i = 0; i < n; ++i) {
+		int key = lo + rand() % ((hi - lo) / step) * step;
+		m.insert(map::value_type(key, key * 10 + tag));
+		s.insert(std::make_pair(key, key * 10 + tag));
+	}
+}
+
+void test_split_join() {
+	puts("Test: split and join");
+	const int range = 3000;
+	long long hash = 0;
+	for (int round = 0; round < 60; ++round) {
+		map a, b;
+		model s;
+		fill(a, s, round % 10 == 0 ? 0 : rand() % 1500, 0, range, 1, 1);
+		int key = rand() % (range + 200) - 100;
+		b.insert(map::value_type(-5, 0)); // split clears it
+		a.split(key, b);
+		model l(s.begin(), s.lower_bound(key)), r(s.lower_bound(key), s.end());
+		same(a, l, range);
+		same(b, r, range);
+		// joining in the wrong order is refused while both sides have elements
+		if (!l.empty() && !r.empty()) {
+			try {
+				b.join(a);
+				check(false, "join out of order");
+			} catch (sjtu::runtime_error &) {}
+			same(a, l, range);
+			same(b, r, range);
+		}
+		a.join(b);
+		same(a, s, range);
+		same(b, model(), range);
+		b.join(a);
+		same(b, s, range);
+		same(a, model(), range);
+		hash = (hash * 31 + l.size()) % MOD;
+	}
+	std::cout << "hash:" << hash << std::endl;
+	result();
+}
+
+/*
+   the other operand: disjoint, overlapping or empty
+ */
+void operand(int round, map &b, model &t) {
+	switch (round % 4) {
+	case 0:
+		fill(b, t, rand() % 800, 1, 2001, 2, 2); // odd keys against even ones
+		break;
+	case 1:
+		fill(b, t, rand() % 800, 0, 2000, 1, 2);
+		break;
+	case 2:
+		break;
+	default:
+		fill(b, t, rand() % 100, 0, 2000, 1, 2); // much smaller
+	}
+}
+
+void test_set_operations() {
+	puts("Test: merge_from, set_union, set_intersection and set_difference");
+	const int range = 2000;
+	long long hash = 0;
+	for (int round = 0; round < 80; ++round) {
+		map a, b;
+		model s, t;
+		fill(a, s, round % 8 == 7 ? 0 : rand() % 800, 0, range, 2, 1);
+		operand(round, b, t);
+		map a2(a), a3(a), a4(a), b2(b);
+		// merge_from: the keys of b not in a move, the rest stay in b
+		model ms(s), mt;
+		for (auto &kv : t) {
+			if (ms.count(kv.first)) mt.insert(kv);
+			else ms.insert(kv);
+		}
+		a.merge_from(b);
+		same(a, ms, range);
+		same(b, mt, range);
+		// set_union copies and leaves b alone
+		a2.set_union(b2);
+		same(a2, ms, range);
+		same(b2, t, range);
+		model is, ds;
+		for (auto &kv : s)
+			(t.count(kv.first) ? is : ds).insert(kv);
+		a3.set_intersection(b2);
+		same(a3, is, range);
+		a4.set_difference(b2);
+		same(a4, ds, range);
+		same(b2, t, range);
+		hash = (hash * 31 + ms.size() * 7 + is.size() * 3 + ds.size()) % MOD;
+	}
+	// with itself
+	map a;
+	model s;
+	fill(a, s, 500, 0, range, 1, 1);
+	a.merge_from(a);
+	a.set_union(a);
+	a.set_intersection(a);
+	same(a, s, range);
+	a.set_difference(a);
+	same(a, model(), range);
+	std::cout << "hash:" << hash << std::endl;
+	result();
+}
+
+int main() {
+	test_split_join();
+	test_set_operations();
+	return 0;
+}
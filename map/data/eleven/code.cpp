@@ -0,0 +1,161 @@
+// btree_map against std::map, with nodes small enough to split and merge often
+
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <map>
+#include "btree_map.hpp"
+
+long long aa = 13131, bb = 5353, MOD = (long long)(1e9 + 7), now = 1;
+int rand() {
+	for (int i = 1; i < 3; i++)
+		now = (now * aa + bb) % MOD;
+	return now;
+}
+
+bool failed = false;
+void check(bool ok, const char *what) {
+	if (!ok && !failed) {
+		std::cout << "wrong: " << what << std::endl;
+		failed = true;
+	}
+}
+void result() {
+	std::cout << (failed ? "fail" : "ok") << std::endl;
+	failed = false;
+}
+
+template<class Map, class Std>
+bool same(const Map &m, const Std &s) {
+	if (m.size() != s.size()) return false;
+	auto it = m.cbegin();
+	for (auto &kv : s) {
+		if (it == m.cend() || it->first != kv.first || it->second != kv.second)
+			return false;
+		++it;
+	}
+	return it == m.cend();
+}
+/*
+   from end() back to begin(), against the std::map walked backwards
+ */
+template<class Map, class Std>
+bool same_backwards(const Map &m, const Std &s) {
+	if (s.empty()) return m.cbegin() == m.cend();
+	auto it = m.cend();
+	for (auto jt = s.rbegin(); jt != s.rend(); ++jt) {
+		--it;
+		if (it->first != jt->first || it->second != jt->second)
+			return false;
+	}
+	return it == m.cbegin();
+}
+
+template<class Key>
+Key make_key(int x);
+template<>
+int make_key<int>(int x) {
+	return x;
+}
+template<>
+std::string make_key<std::string>(int x) {
+	return std::to_string(x);
+}
+
+/*
+   grows past a few levels of splits, then shrinks through borrows and
+   merges back to nothing, checking the order every so often
+ */
+template<class Key, size_t NodeBytes>
+void test(const char *name, int range) {
+	typedef sjtu::btree_map<Key, int, std::less<Key>, NodeBytes> map;
+	std::cout << "Test: " << name << std::endl;
+	map m;
+	std::map<Key, int> s;
+	long long hash = 0;
+	for (int round = 0; round < 3; ++round) {
+		for (int step = 0; step < range * 2; ++step) {
+			Key key = make_key<Key>(rand() % range);
+			int val = rand() % 1000;
+			bool in = m.insert(typename map::value_type(key, val)).second;
+			check(in == s.insert(std::make_pair(key, val)).second, "insert");
+			if (step % 997 == 0) check(same(m, s), "order after insert");
+		}
+		check(same(m, s) && same_backwards(m, s), "grown");
+		for (int step = 0; step < range * 3; ++step) {
+			int op = rand() % 8;
+			Key key = make_key<Key>(rand() % range);
+			if (op < 4) {
+				auto it = m.find(key);
+				auto jt = s.find(key);
+				check((it == m.end()) == (jt == s.end()), "find before erase");
+				check(m.count(key) == s.count(key), "count");
+				if (jt != s.end()) {
+					m.erase(it);
+					s.erase(jt);
+				}
+			} else if (op < 6) {
+				auto it = m.lower_bound(key);
+				auto jt = s.lower_bound(key);
+				check((it == m.end()) == (jt == s.end()), "lower_bound");
+				if (jt != s.end()) {
+					check(it->first == jt->first, "lower_bound key");
+					hash = (hash * 31 + it->second) % MOD;
+				}
+			} else if (op < 7) {
+				auto it = m.upper_bound(key);
+				auto jt = s.upper_bound(key);
+				check((it == m.end()) == (jt == s.end()), "upper_bound");
+				if (jt != s.end()) check(it->first == jt->first, "upper_bound key");
+			} else if (!s.empty()) {
+				auto it = m.find(key);
+				if (it != m.end()) {
+					check(m.at(key) == s[key], "at");
+					m[key] = s[key] = rand() % 1000;
+				}
+			}
+			check(m.size() == s.size(), "size");
+			if (step % 997 == 0) check(same(m, s), "order after erase");
+		}
+		check(same(m, s) && same_backwards(m, s), "shrunk");
+	}
+	map c(m), d;
+	d = m;
+	check(same(c, s) && same(d, s), "copy");
+	d = d;
+	check(same(d, s), "self assignment");
+	std::map<Key, int> saved(s);
+	while (!s.empty()) {
+		Key key = s.begin()->first;
+		m.erase(m.begin());
+		s.erase(s.begin());
+		if (!s.empty()) {
+			auto it = m.end();
+			--it;
+			check(it->first == s.rbegin()->first, "last");
+			m.erase(it);
+			s.erase(--s.end());
+		}
+		check(m.find(key) == m.end(), "gone");
+	}
+	check(m.empty() && m.begin() == m.end(), "emptied");
+	check(same(c, saved) && same(d, saved), "copies kept");
+	try {
+		m.at(make_key<Key>(0));
+		check(false, "at on an empty map");
+	} catch (sjtu::index_out_of_bound &) {}
+	try {
+		auto it = m.end();
+		--it;
+		check(false, "-- on end() of an empty map");
+	} catch (sjtu::invalid_iterator &) {}
+	std::cout << "size:" << c.size() << " hash:" << hash << std::endl;
+	result();
+}
+
+int main() {
+	test<int, 256>("int keys", 20000);
+	test<int, 16>("int keys, four slots a node", 5000);
+	test<std::string, 64>("string keys, small nodes", 5000);
+	return 0;
+}
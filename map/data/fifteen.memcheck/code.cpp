@@ -0,0 +1,170 @@
+// persistent_map: snapshots against copies of std::map, freed in any order
+
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <vector>
+#include "persistent_map.hpp"
+
+long long aa = 13131, bb = 5353, MOD = (long long)(1e9 + 7), now = 1;
+int rand() {
+	for (int i = 1; i < 3; i++)
+		now = (now * aa + bb) % MOD;
+	return now;
+}
+
+bool failed = false;
+void check(bool ok, const char *what) {
+	if (!ok && !failed) {
+		std::cout << "wrong: " << what << std::endl;
+		failed = true;
+	}
+}
+void result() {
+	std::cout << (failed ? "fail" : "ok") << std::endl;
+	failed = false;
+}
+
+/*
+   counts the values alive, a node freed twice or never shows here
+ */
+int alive = 0;
+struct counted {
+	int v;
+	counted(int v = 0): v(v) {
+		++alive;
+	}
+	counted(const counted &o): v(o.v) {
+		++alive;
+	}
+	counted& operator=(const counted &o) {
+		v = o.v;
+		return *this;
+	}
+	~counted() {
+		--alive;
+	}
+};
+
+typedef sjtu::persistent_map<int, counted> map;
+
+bool same(const map &m, const std::map<int, int> &s) {
+	if (m.size() != s.size()) return false;
+	auto it = m.cbegin();
+	for (auto &kv : s) {
+		if (it == m.cend() || it->first != kv.first || it->second.v != kv.second)
+			return false;
+		++it;
+	}
+	return it == m.cend();
+}
+
+void test_snapshots() {
+	puts("Test: snapshots, mutate, compare, destroy in any order");
+	std::vector<map*> snaps;
+	std::vector<std::map<int, int>> want;
+	map m;
+	std::map<int, int> s;
+	long long hash = 0;
+	for (int step = 0; step < 40000; ++step) {
+		int op = rand() % 20, key = rand() % 500, val = rand() % 1000;
+		if (op < 7) {
+			bool in = m.insert(map::value_type(key, counted(val))).second;
+			check(in == s.insert(std::make_pair(key, val)).second, "insert");
+		} else if (op < 11) {
+			bool in = m.insert_or_assign(key, counted(val)).second;
+			check(in == !s.count(key), "insert_or_assign");
+			s[key] = val;
+		} else if (op < 15) {
+			check(m.erase(key) == s.erase(key), "erase");
+		} else if (op < 16) {
+			// a snapshot three ways: copy, snapshot() and assignment
+			map *x;
+			if (step % 3 == 0) {
+				x = new map(m);
+			} else if (step % 3 == 1) {
+				x = new map(m.snapshot());
+			} else {
+				x = new map();
+				*x = m;
+			}
+			snaps.push_back(x);
+			want.push_back(s);
+		} else if (op < 18 && snaps.size() > 12) {
+			// drop a snapshot from anywhere, so versions die in any order
+			size_t i = rand() % snaps.size();
+			check(same(*snaps[i], want[i]), "snapshot before it is dropped");
+			delete snaps[i];
+			snaps[i] = snaps.back();
+			snaps.pop_back();
+			want[i] = want.back();
+			want.pop_back();
+		} else if (op < 19 && !snaps.empty()) {
+			// go back to a snapshot and carry on from there
+			size_t i = rand() % snaps.size();
+			m = *snaps[i];
+			s = want[i];
+		} else {
+			auto it = m.find(key);
+			check((it == m.cend()) == !s.count(key), "find");
+			if (it != m.cend()) {
+				check(it->second.v == s[key] && m.at(key).v == s[key], "value");
+				hash = (hash * 31 + it->second.v) % MOD;
+			}
+		}
+		check(m.size() == s.size(), "size");
+		if (step % 997 == 0)
+			for (size_t i = 0; i < snaps.size(); ++i)
+				check(same(*snaps[i], want[i]), "snapshot after changes");
+	}
+	check(same(m, s), "current version");
+	for (size_t i = 0; i < snaps.size(); ++i)
+		check(same(*snaps[i], want[i]), "snapshot at the end");
+	std::cout << "snapshots:" << snaps.size() << " size:" << s.size() << " hash:" << hash << std::endl;
+	// oldest first, then m: every value must go with the last version holding it
+	for (size_t i = 0; i < snaps.size(); ++i)
+		delete snaps[i];
+	m.clear();
+	check(alive == 0, "every value freed");
+	result();
+}
+
+void test_shared_path() {
+	puts("Test: insert_or_assign on a path shared with snapshots");
+	map m;
+	for (int i = 0; i < 1000; ++i)
+		m.insert(map::value_type(i, counted(i)));
+	std::vector<map> snaps;
+	for (int round = 0; round < 20; ++round) {
+		snaps.push_back(m);
+		auto it = snaps.back().find(round * 37 % 1000);
+		// every key on the way down is shared with the snapshots
+		for (int k = 0; k < 1000; k += 1 + round)
+			m.insert_or_assign(k, counted(m.at(k).v + 1));
+		check(it->second.v == snaps.back().at(it->first).v, "iterator of a snapshot");
+	}
+	for (size_t r = 0; r < snaps.size(); ++r) {
+		for (int k = 0; k < 1000; ++k) {
+			int v = k;
+			for (size_t q = 0; q < r; ++q)
+				v += k % (1 + q) == 0;
+			check(snaps[r].at(k).v == v, "snapshot kept its values");
+		}
+	}
+	long long sum = 0;
+	for (auto it = m.cbegin(); it != m.cend(); ++it)
+		sum += it->second.v;
+	// the latest first this time
+	while (!snaps.empty())
+		snaps.pop_back();
+	m.clear();
+	check(alive == 0, "every value freed");
+	std::cout << "sum:" << sum << std::endl;
+	result();
+}
+
+int main() {
+	test_snapshots();
+	test_shared_path();
+	return 0;
+}
@@ -0,0 +1,152 @@
+// static_map against std::map, on sizes around the edges of its layout
+
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <vector>
+#include "map.hpp"
+#include "btree_map.hpp"
+#include "flat_map.hpp"
+#include "static_map.hpp"
+
+long long aa = 13131, bb = 5353, MOD = (long long)(1e9 + 7), now = 1;
+int rand() {
+	for (int i = 1; i < 3; i++)
+		now = (now * aa + bb) % MOD;
+	return now;
+}
+
+bool failed = false;
+void check(bool ok, const char *what) {
+	if (!ok && !failed) {
+		std::cout << "wrong: " << what << std::endl;
+		failed = true;
+	}
+}
+void result() {
+	std::cout << (failed ? "fail" : "ok") << std::endl;
+	failed = false;
+}
+
+typedef sjtu::static_map<int, int> frozen;
+
+/*
+   everything a static_map answers, against the std::map it was built from
+ */
+void check_all(const frozen &f, const std::map<int, int> &s, int range) {
+	check(f.size() == s.size() && f.empty() == s.empty(), "size");
+	int i = 0;
+	auto it = f.begin();
+	for (auto &kv : s) {
+		check(it != f.end() && (*it).first == kv.first && (*it).second == kv.second, "order");
+		check(f.nth(i) == it && f.rank(i + 1) == it, "nth and rank");
+		check(f.index_of(it) == i && f.index_of(kv.first) == i, "index_of");
+		check(f.begin() + i == it && it - f.begin() == i, "iterator arithmetic");
+		++it;
+		++i;
+	}
+	check(it == f.end() && f.nth(i) == f.end() && f.rank(0) == f.end() && f.rank(i + 1) == f.end(), "past the end");
+	check(f.index_of(f.end()) == i, "index_of end()");
+	// back from end() to begin()
+	it = f.end();
+	for (auto jt = s.rbegin(); jt != s.rend(); ++jt) {
+		--it;
+		check((*it).first == jt->first, "reverse order");
+	}
+	check(it == f.begin(), "back at begin()");
+	try {
+		--it;
+		check(false, "-- on begin()");
+	} catch (sjtu::invalid_iterator &) {}
+	int less = 0; // elements of s below key
+	for (int key = -1; key <= range; ++key) {
+		auto lo = s.lower_bound(key), up = s.upper_bound(key);
+		auto flo = f.lower_bound(key), fup = f.upper_bound(key);
+		check((flo == f.end()) == (lo == s.end()) && (lo == s.end() || (*flo).first == lo->first), "lower_bound");
+		check((fup == f.end()) == (up == s.end()) && (up == s.end() || (*fup).first == up->first), "upper_bound");
+		check(f.count(key) == s.count(key), "count");
+		check(f.index_of(key) == less, "index_of a key");
+		if (s.count(key)) check(f.at(key) == s.at(key) && (*f.find(key)).second == s.at(key), "at");
+		else check(f.find(key) == f.end(), "find a missing key");
+		less += s.count(key);
+	}
+}
+
+void test_sizes() {
+	puts("Test: sizes around the layout");
+	// 0, 1, 2, the cache line of int keys, full trees and one more, and a big one
+	int sizes[] = {0, 1, 2, 3, 15, 16, 17, 31, 32, 33, 63, 64, 65, 255, 256, 257, 1000, 50000};
+	for (int n : sizes) {
+		std::map<int, int> s;
+		std::vector<sjtu::pair<int, int>> v;
+		for (int i = 0; i < n; ++i) {
+			s[i * 2] = rand() % 1000;
+			v.push_back(sjtu::pair<int, int>(i * 2, s[i * 2]));
+		}
+		frozen f(sjtu::sorted_unique, v.begin(), v.end());
+		check_all(f, s, 2 * n);
+		frozen c(f), d;
+		d = f;
+		check_all(c, s, 2 * n);
+		check_all(d, s, 2 * n);
+	}
+	frozen e;
+	try {
+		auto it = e.end();
+		--it;
+		check(false, "-- on end() of an empty map");
+	} catch (sjtu::invalid_iterator &) {}
+	try {
+		e.at(0);
+		check(false, "at on an empty map");
+	} catch (sjtu::index_out_of_bound &) {}
+	result();
+}
+
+void test_unsorted() {
+	puts("Test: sorted_unique on input out of order");
+	for (int round = 0; round < 100; ++round) {
+		std::map<int, int> s;
+		std::vector<sjtu::pair<int, int>> v;
+		int n = rand() % 300;
+		for (int i = 0; i < n; ++i) {
+			int key = round % 2 ? rand() % 200 : i - (i % 10 == 9);
+			v.push_back(sjtu::pair<int, int>(key, i));
+			s.insert(std::make_pair(key, i));
+		}
+		frozen f(sjtu::sorted_unique, v.begin(), v.end());
+		check_all(f, s, 300);
+	}
+	result();
+}
+
+void test_freeze() {
+	puts("Test: freeze sjtu::map, btree_map and flat_map");
+	sjtu::map<int, int> m;
+	sjtu::btree_map<int, int> b;
+	sjtu::flat_map<int, int> fl;
+	std::map<int, int> s;
+	for (int i = 0; i < 5000; ++i) {
+		int key = rand() % 20000, val = rand() % 1000;
+		m.insert(sjtu::pair<const int, int>(key, val));
+		b.insert(sjtu::pair<const int, int>(key, val));
+		fl.insert(sjtu::pair<const int, int>(key, val));
+		s.insert(std::make_pair(key, val));
+	}
+	frozen a = m.freeze(), c(b), d(fl);
+	check_all(a, s, 20000);
+	check_all(c, s, 20000);
+	check_all(d, s, 20000);
+	long long hash = 0;
+	for (auto it = a.begin(); it != a.end(); ++it)
+		hash = (hash * 31 + (*it).second) % MOD;
+	std::cout << "size:" << a.size() << " hash:" << hash << std::endl;
+	result();
+}
+
+int main() {
+	test_sizes();
+	test_unsorted();
+	test_freeze();
+	return 0;
+}
@@ -0,0 +1,175 @@
+// balancing policies against std::map, with the shape of the tree checked
+
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <vector>
+#include "map.hpp"
+
+long long aa = 13131, bb = 5353, MOD = (long long)(1e9 + 7), now = 1;
+int rand() {
+	for (int i = 1; i < 3; i++)
+		now = (now * aa + bb) % MOD;
+	return now;
+}
+
+struct sum {
+	typedef long long value_type;
+	static value_type identity() {
+		return 0;
+	}
+	static value_type of(const sjtu::pair<const int, int> &e) {
+		return e.second;
+	}
+	static value_type combine(const value_type &l, const value_type &r) {
+		return l + r;
+	}
+};
+
+bool failed = false;
+void check(bool ok, const char *what) {
+	if (!ok && !failed) {
+		std::cout << "wrong: " << what << std::endl;
+		failed = true;
+	}
+}
+
+/*
+   the shape every policy keeps: sizes, parents, sums, key order,
+   and the thread going through the nodes in order
+ */
+template<class Map, class Node>
+int walk(const Map &m, const Node *o, const Node *fa, std::vector<const Node*> &order) {
+	if (!o) return 0;
+	check(o->fa == fa, "parent");
+	int l = walk(m, o->lc, o, order);
+	order.push_back(o);
+	int r = walk(m, o->rc, o, order);
+	check(o->sz == l + r + 1, "size");
+	check(sjtu::augment_field<sum>::get(o) == sjtu::augment_field<sum>::get(o->lc) + o->val->second + sjtu::augment_field<sum>::get(o->rc), "sum");
+	return l + r + 1;
+}
+template<class Map>
+void check_tree(const Map &m) {
+	typedef typename Map::node node;
+	std::vector<const node*> order;
+	check(walk(m, m.tree_root(), (const node*)0, order) == (int)m.size(), "size of root");
+	for (size_t i = 0; i + 1 < order.size(); ++i) {
+		check(order[i]->val->first < order[i + 1]->val->first, "order");
+		check(order[i]->nxt == order[i + 1] && order[i + 1]->pre == order[i], "thread");
+	}
+}
+
+template<class N>
+void check_policy(const N *o, sjtu::treap_balance) {
+	if (!o) return;
+	check(!o->lc || o->lc->r <= o->r, "heap");
+	check(!o->rc || o->rc->r <= o->r, "heap");
+	check_policy(o->lc, sjtu::treap_balance());
+	check_policy(o->rc, sjtu::treap_balance());
+}
+template<class N>
+int avl_height(const N *o) {
+	if (!o) return 0;
+	int l = avl_height(o->lc), r = avl_height(o->rc);
+	check(l - r <= 1 && r - l <= 1, "avl balance");
+	int h = (l > r ? l : r) + 1;
+	check(o->r == h, "avl height");
+	return h;
+}
+template<class N>
+void check_policy(const N *o, sjtu::avl_balance) {
+	avl_height(o);
+}
+template<class N>
+int black_height(const N *o) {
+	if (!o) return 1;
+	if (o->r == sjtu::red_black_balance::red) {
+		check(!sjtu::red_black_balance::is_red(o->lc) && !sjtu::red_black_balance::is_red(o->rc), "red under red");
+	}
+	int l = black_height(o->lc), r = black_height(o->rc);
+	check(l == r, "black height");
+	return l + (o->r == sjtu::red_black_balance::black);
+}
+template<class N>
+void check_policy(const N *o, sjtu::red_black_balance) {
+	check(!sjtu::red_black_balance::is_red(o), "red root");
+	black_height(o);
+}
+
+template<class Policy>
+void test(const char *name) {
+	typedef sjtu::map<int, int, std::less<int>, Policy, sum> map;
+	std::cout << "Test: " << name << std::endl;
+	failed = false;
+	map m;
+	std::map<int, int> s;
+	long long hash = 0;
+	for (int step = 0; step < 60000; ++step) {
+		int op = rand() % 12, key = rand() % 5000, val = rand() % 1000;
+		if (op < 4) {
+			bool in = m.insert(typename map::value_type(key, val)).second;
+			check(in == s.insert(std::make_pair(key, val)).second, "insert");
+		} else if (op < 5) {
+			m.insert_or_assign(key, val);
+			s[key] = val;
+		} else if (op < 6) {
+			auto h = m.lower_bound(key);
+			m.emplace_hint(h, key, val);
+			s.emplace(key, val);
+		} else if (op < 8) {
+			check(m.erase(key) == s.erase(key), "erase key");
+		} else if (op < 9 && !s.empty()) {
+			auto it = m.lower_bound(key);
+			if (it != m.end()) {
+				s.erase(it->first);
+				m.erase(it);
+			}
+		} else if (op < 10 && step % 50 == 0) {
+			int hi = key + rand() % 200;
+			m.erase(m.lower_bound(key), m.lower_bound(hi));
+			s.erase(s.lower_bound(key), s.lower_bound(hi));
+		} else {
+			auto it = m.find(key);
+			auto jt = s.find(key);
+			check((it == m.end()) == (jt == s.end()), "find");
+			if (jt != s.end()) {
+				check(it->second == jt->second, "value");
+				hash = (hash * 31 + it->second) % MOD;
+			}
+		}
+		check(m.size() == s.size(), "size");
+		if (step % 5000 == 0) {
+			check_tree(m);
+			check_policy(m.tree_root(), Policy());
+			long long tot = 0;
+			for (auto &kv : s) tot += kv.second;
+			check(m.reduce() == tot, "reduce");
+		}
+	}
+	map c(m);
+	check_tree(c);
+	check_policy(c.tree_root(), Policy());
+	auto it = c.cbegin();
+	for (auto &kv : s) {
+		check(it->first == kv.first && it->second == kv.second, "copy");
+		++it;
+	}
+	std::vector<sjtu::pair<int, int>> sorted;
+	for (int i = 0; i < 3000; ++i)
+		sorted.push_back(sjtu::pair<int, int>(i * 2, i));
+	map b(sjtu::sorted_unique, sorted.begin(), sorted.end());
+	check_tree(b);
+	check_policy(b.tree_root(), Policy());
+	m.clear();
+	check(m.empty() && m.begin() == m.end() && !m.tree_root(), "clear");
+	std::cout << "size:" << s.size() << " hash:" << hash << std::endl;
+	std::cout << (failed ? "fail" : "ok") << std::endl;
+}
+
+int main() {
+	test<sjtu::treap_balance>("treap");
+	test<sjtu::avl_balance>("avl");
+	test<sjtu::red_black_balance>("red black");
+	return 0;
+}
@@ -0,0 +1,186 @@
+// find_many and node handles against std::map
+
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <vector>
+#include <utility>
+#include "map.hpp"
+
+long long aa = 13131, bb = 5353, MOD = (long long)(1e9 + 7), now = 1;
+int rand() {
+	for (int i = 1; i < 3; i++)
+		now = (now * aa + bb) % MOD;
+	return now;
+}
+
+bool failed = false;
+void check(bool ok, const char *what) {
+	if (!ok && !failed) {
+		std::cout << "wrong: " << what << std::endl;
+		failed = true;
+	}
+}
+void result() {
+	std::cout << (failed ? "fail" : "ok") << std::endl;
+	failed = false;
+}
+
+/*
+   counts the values alive, a node leaked or freed twice shows here
+ */
+int alive = 0;
+struct counted {
+	int v;
+	counted(int v = 0): v(v) {
+		++alive;
+	}
+	counted(const counted &o): v(o.v) {
+		++alive;
+	}
+	counted& operator=(const counted &o) {
+		v = o.v;
+		return *this;
+	}
+	~counted() {
+		--alive;
+	}
+};
+
+typedef sjtu::map<int, counted> map;
+typedef std::map<int, int> model;
+
+bool same(const map &m, const model &s) {
+	if (m.size() != s.size()) return false;
+	auto it = m.cbegin();
+	int i = 0;
+	for (auto &kv : s) {
+		if (it == m.cend() || it->first != kv.first || it->second.v != kv.second || m.index_of(kv.first) != i)
+			return false;
+		++it;
+		++i;
+	}
+	return it == m.cend();
+}
+
+void test_find_many() {
+	puts("Test: find_many with missing and repeated keys");
+	map m;
+	model s;
+	for (int i = 0; i < 20000; ++i) {
+		int key = rand() % 50000;
+		m.insert(map::value_type(key, counted(key * 3)));
+		s.insert(std::make_pair(key, key * 3));
+	}
+	long long hash = 0;
+	for (int round = 0; round < 50; ++round) {
+		// lengths around the size of a group, keys repeated on purpose
+		int len = round < 20 ? round : rand() % 300;
+		std::vector<int> keys;
+		for (int i = 0; i < len; ++i)
+			keys.push_back(i && rand() % 4 == 0 ? keys[rand() % i] : rand() % 50010 - 5);
+		std::vector<map::iterator> out(len + 1);
+		auto end = m.find_many(keys.begin(), keys.end(), out.begin());
+		check(end == out.begin() + len, "returned iterator");
+		const map &c = m;
+		std::vector<map::const_iterator> found(len);
+		c.find_many(keys.begin(), keys.end(), found.begin());
+		for (int i = 0; i < len; ++i) {
+			bool in = s.count(keys[i]);
+			check(out[i] == m.find(keys[i]) && found[i] == c.find(keys[i]), "find_many against find");
+			check((out[i] == m.end()) == !in, "missing key");
+			if (in) {
+				check(out[i]->second.v == keys[i] * 3, "value");
+				hash = (hash * 31 + out[i]->second.v) % MOD;
+			}
+		}
+	}
+	map e;
+	int k[] = {1, 2, 3};
+	map::iterator r[3];
+	e.find_many(k, k + 3, r);
+	check(r[0] == e.end() && r[1] == e.end() && r[2] == e.end(), "an empty map");
+	std::cout << "hash:" << hash << std::endl;
+	result();
+}
+
+void test_node_handles() {
+	puts("Test: node handles moved between maps");
+	{
+		map::node_type kept; // outlives both maps
+		map a, b;
+		model s, t;
+		for (int i = 0; i < 3000; ++i) {
+			int key = rand() % 5000;
+			a.insert(map::value_type(key, counted(i)));
+			s.insert(std::make_pair(key, i));
+		}
+		for (int step = 0; step < 20000; ++step) {
+			int op = rand() % 6, key = rand() % 5000, side = rand() % 2;
+			map &from = side ? a : b, &to = side ? b : a;
+			model &fs = side ? s : t, &ts = side ? t : s;
+			if (op < 4) {
+				// by key, through a chain of moves, changed on the way
+				map::node_type h = from.extract(key);
+				check(h.empty() == !fs.count(key), "extract by key");
+				if (h.empty()) continue;
+				check(h.key() == key && h.mapped().v == fs[key], "handle contents");
+				map::node_type g(std::move(h));
+				map::node_type f;
+				f = std::move(g);
+				check(h.empty() && g.empty() && !f.empty() && bool(f), "moved");
+				f.mapped().v += 1;
+				int v = fs[key] + 1;
+				fs.erase(key);
+				auto r = to.insert(std::move(f));
+				check(r.inserted == !ts.count(key) && f.empty(), "insert a handle");
+				if (r.inserted) {
+					check(r.position->first == key && r.position->second.v == v && r.node.empty(), "inserted");
+					ts[key] = v;
+				} else {
+					// the key is taken: the node comes back, put it home again
+					check(r.position == to.find(key) && r.node.key() == key, "handed back");
+					check(from.insert(std::move(r.node)).inserted, "back home");
+					fs[key] = v;
+				}
+			} else if (op < 5 && step % 3 == 0 && !from.empty()) {
+				// by iterator, then dropped without being inserted
+				int i = rand() % from.size();
+				map::iterator it = from.begin() + i;
+				int k = it->first;
+				{
+					map::node_type h = from.extract(it);
+					check(h.key() == k, "extract by iterator");
+				}
+				fs.erase(k);
+			} else {
+				// an empty handle
+				map::node_type h = from.extract(-1);
+				check(h.empty() && !h, "extract a missing key");
+				auto r = to.insert(std::move(h));
+				check(!r.inserted && r.position == to.end() && r.node.empty(), "insert an empty handle");
+				try {
+					h.key();
+					check(false, "key() of an empty handle");
+				} catch (sjtu::container_is_empty &) {}
+			}
+			check(a.size() == s.size() && b.size() == t.size(), "size");
+			if (step % 997 == 0) check(same(a, s) && same(b, t), "both maps");
+		}
+		check(same(a, s) && same(b, t), "both maps at the end");
+		check(alive == int(s.size() + t.size()), "no value lost or kept");
+		std::cout << "sizes:" << s.size() << ' ' << t.size() << std::endl;
+		kept = a.extract(a.begin());
+		map::node_type h = b.extract(b.begin());
+		a.clear();
+		check(!kept.empty() && kept.mapped().v >= 0, "a handle outlives clear()");
+	}
+	check(alive == 0, "every value freed");
+	result();
+}
+
+int main() {
+	test_find_many();
+	test_node_handles();
+	return 0;
+}
@@ -0,0 +1,164 @@
+// interval_map: overlap and stabbing queries against a brute force scan
+
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <vector>
+#include "interval_map.hpp"
+
+long long aa = 13131, bb = 5353, MOD = (long long)(1e9 + 7), now = 1;
+int rand() {
+	for (int i = 1; i < 3; i++)
+		now = (now * aa + bb) % MOD;
+	return now;
+}
+
+bool failed = false;
+void check(bool ok, const char *what) {
+	if (!ok && !failed) {
+		std::cout << "wrong: " << what << std::endl;
+		failed = true;
+	}
+}
+void result() {
+	std::cout << (failed ? "fail" : "ok") << std::endl;
+	failed = false;
+}
+
+typedef sjtu::pair<int, int> interval;
+typedef sjtu::interval_map<interval, int> map;
+
+/*
+   the intervals by start, then end, as a std::map keyed the same way
+ */
+typedef std::map<std::pair<int, int>, int> brute;
+
+/*
+   what overlapping(a, b) should give, in start order:
+   [s, e] meets [a, b] when s <= b, a <= e and it is not empty
+ */
+std::vector<std::pair<int, int>> scan(const brute &s, int a, int b) {
+	std::vector<std::pair<int, int>> r;
+	for (auto &kv : s)
+		if (kv.first.first <= kv.first.second && kv.first.first <= b && a <= kv.first.second)
+			r.push_back(kv.first);
+	return r;
+}
+template<class Range>
+bool same(Range q, const std::vector<std::pair<int, int>> &want, const brute &s) {
+	size_t i = 0;
+	for (auto it = q.begin(); it != q.end(); ++it, ++i) {
+		if (i == want.size() || it->first.first != want[i].first || it->first.second != want[i].second)
+			return false;
+		if (it->second != s.at(want[i]))
+			return false;
+	}
+	return i == want.size();
+}
+
+/*
+   a few shapes of interval: random, empty (second < first), a point,
+   one that ends where another starts, and one sharing a start
+ */
+interval make(const brute &s, int range) {
+	int a = rand() % range, len = rand() % 30;
+	switch (rand() % 6) {
+	case 0:
+		return interval(a, a - 1 - rand() % 5);
+	case 1:
+		return interval(a, a);
+	case 2:
+		if (!s.empty()) {
+			auto it = s.lower_bound(std::make_pair(a, a));
+			if (it == s.end()) it = s.begin();
+			return interval(it->first.second, it->first.second + len);
+		}
+		break;
+	case 3:
+		if (!s.empty()) {
+			auto it = s.lower_bound(std::make_pair(a, a));
+			if (it == s.end()) it = s.begin();
+			return interval(it->first.first, it->first.first + len);
+		}
+		break;
+	}
+	return interval(a, a + len);
+}
+
+void test_random() {
+	puts("Test: random intervals against a scan");
+	const int range = 1000;
+	map m;
+	brute s;
+	long long hash = 0;
+	for (int step = 0; step < 30000; ++step) {
+		int op = rand() % 10;
+		if (op < 4) {
+			interval x = make(s, range);
+			int v = rand() % 1000;
+			bool in = m.insert(map::value_type(x, v)).second;
+			check(in == s.insert(std::make_pair(std::make_pair(x.first, x.second), v)).second, "insert");
+		} else if (op < 5) {
+			interval x = make(s, range);
+			int v = rand() % 1000;
+			m.insert_or_assign(x, v);
+			s[std::make_pair(x.first, x.second)] = v;
+		} else if (op < 7 && !s.empty()) {
+			// erase something that is there, then ask around it
+			auto it = s.lower_bound(std::make_pair(rand() % range, 0));
+			if (it == s.end()) it = s.begin();
+			std::pair<int, int> k = it->first;
+			check(m.erase(interval(k.first, k.second)) == 1, "erase");
+			s.erase(it);
+			check(same(m.overlapping(k.first, k.second), scan(s, k.first, k.second), s), "query after erase");
+			check(same(m.stabbing(k.first), scan(s, k.first, k.first), s), "stabbing after erase");
+		} else if (op < 9) {
+			int a = rand() % (range + 40) - 20, b = a + rand() % 60 - 5;
+			auto want = scan(s, a, b);
+			check(same(m.overlapping(a, b), want, s), "overlapping");
+			hash = (hash * 31 + want.size()) % MOD;
+		} else {
+			int x = rand() % (range + 40) - 20;
+			auto want = scan(s, x, x);
+			check(same(m.stabbing(x), want, s), "stabbing");
+			hash = (hash * 31 + want.size()) % MOD;
+		}
+		check(m.size() == s.size(), "size");
+	}
+	std::cout << "size:" << s.size() << " hash:" << hash << std::endl;
+	result();
+}
+
+void test_by_hand() {
+	puts("Test: touching endpoints, equal starts and empty intervals");
+	map m;
+	brute s;
+	int xs[][2] = {{1, 3}, {3, 5}, {5, 5}, {1, 1}, {1, 8}, {6, 4}, {9, 2}, {7, 7}, {0, 0}};
+	for (auto &x : xs) {
+		m.insert(map::value_type(interval(x[0], x[1]), x[0] * 10 + x[1]));
+		s[std::make_pair(x[0], x[1])] = x[0] * 10 + x[1];
+	}
+	for (int a = -1; a <= 10; ++a)
+		for (int b = a - 2; b <= 10; ++b)
+			check(same(m.overlapping(a, b), scan(s, a, b), s), "every query");
+	for (auto kv : m.stabbing(3))
+		std::cout << '[' << kv.first.first << ',' << kv.first.second << "] ";
+	puts("");
+	for (auto kv : m.stabbing(5))
+		std::cout << '[' << kv.first.first << ',' << kv.first.second << "] ";
+	puts("");
+	m.erase(interval(1, 8));
+	s.erase(std::make_pair(1, 8));
+	for (int x = -1; x <= 10; ++x)
+		check(same(m.stabbing(x), scan(s, x, x), s), "stabbing after erase");
+	check(m.stabbing(6).begin() == m.stabbing(6).end(), "nothing at 6");
+	const map &c = m;
+	check(same(c.overlapping(0, 10), scan(s, 0, 10), s), "const query");
+	result();
+}
+
+int main() {
+	test_random();
+	test_by_hand();
+	return 0;
+}
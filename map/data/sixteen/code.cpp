@@ -0,0 +1,224 @@
+// lru_map against a list kept by hand, with weights and the eviction order
+
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <list>
+#include <vector>
+#include "lru_map.hpp"
+
+long long aa = 13131, bb = 5353, MOD = (long long)(1e9 + 7), now = 1;
+int rand() {
+	for (int i = 1; i < 3; i++)
+		now = (now * aa + bb) % MOD;
+	return now;
+}
+
+bool failed = false;
+void check(bool ok, const char *what) {
+	if (!ok && !failed) {
+		std::cout << "wrong: " << what << std::endl;
+		failed = true;
+	}
+}
+void result() {
+	std::cout << (failed ? "fail" : "ok") << std::endl;
+	failed = false;
+}
+
+/*
+   a value weighs its length
+ */
+struct by_length {
+	size_t operator()(int, const std::string &s) const {
+		return s.size();
+	}
+};
+
+typedef sjtu::lru_map<int, std::string, std::less<int>, by_length> cache;
+
+/*
+   the cache by hand: most recently used first, evictions in a log
+ */
+struct model {
+	struct item {
+		int key;
+		std::string val;
+	};
+	std::list<item> order;
+	size_t total, cap;
+	std::vector<int> log;
+
+	explicit model(size_t cap): total(0), cap(cap) {}
+	std::list<item>::iterator find(int key) {
+		for (auto it = order.begin(); it != order.end(); ++it)
+			if (it->key == key) return it;
+		return order.end();
+	}
+	void touch(std::list<item>::iterator it) {
+		order.splice(order.begin(), order, it);
+	}
+	void shrink() {
+		while (total > cap) {
+			total -= order.back().val.size();
+			log.push_back(order.back().key);
+			order.pop_back();
+		}
+	}
+	void admit(int key, const std::string &val) {
+		if (val.size() > cap) {
+			log.push_back(key);
+			return;
+		}
+		order.push_front(item{key, val});
+		total += val.size();
+		shrink();
+	}
+	bool insert(int key, const std::string &val) {
+		auto it = find(key);
+		if (it != order.end()) {
+			touch(it);
+			return false;
+		}
+		admit(key, val);
+		return true;
+	}
+	bool insert_or_assign(int key, const std::string &val) {
+		auto it = find(key);
+		if (it == order.end()) {
+			admit(key, val);
+			return true;
+		}
+		total -= it->val.size();
+		order.erase(it);
+		admit(key, val);
+		return false;
+	}
+	size_t erase(int key) {
+		auto it = find(key);
+		if (it == order.end()) return 0;
+		total -= it->val.size();
+		order.erase(it);
+		return 1;
+	}
+};
+
+bool same(const cache &c, const model &m) {
+	if (c.size() != m.order.size() || c.weight() != m.total) return false;
+	auto it = c.cbegin();
+	for (auto &x : m.order) {
+		if (it == c.cend() || it->first != x.key || it->second != x.val)
+			return false;
+		++it;
+	}
+	return it == c.cend();
+}
+
+std::string text(int len) {
+	std::string s;
+	for (int i = 0; i < len; ++i)
+		s += char('a' + rand() % 26);
+	return s;
+}
+
+void test_random() {
+	puts("Test: random operations against the model");
+	cache c(200);
+	model m(200);
+	std::vector<int> log;
+	c.on_evict([&log](const int &k, std::string &) {
+		log.push_back(k);
+	});
+	long long hash = 0;
+	for (int step = 0; step < 30000; ++step) {
+		int op = rand() % 20, key = rand() % 60;
+		if (op < 6) {
+			// sometimes heavier than the whole budget
+			std::string v = text(rand() % 50 == 0 ? 201 + rand() % 20 : rand() % 25);
+			check(c.insert(cache::value_type(key, v)).second == m.insert(key, v), "insert");
+		} else if (op < 10) {
+			std::string v = text(rand() % 50 == 0 ? 201 + rand() % 20 : rand() % 25);
+			auto r = c.insert_or_assign(key, v);
+			check(r.second == m.insert_or_assign(key, v), "insert_or_assign");
+			check((r.first == c.end()) == (v.size() > m.cap), "heavier than the budget");
+		} else if (op < 12) {
+			check(c.erase(key) == m.erase(key), "erase");
+		} else if (op < 15) {
+			auto it = c.find(key);
+			auto jt = m.find(key);
+			check((it == c.end()) == (jt == m.order.end()), "find");
+			if (jt != m.order.end()) {
+				m.touch(jt);
+				check(it->second == jt->val, "find value");
+				hash = (hash * 31 + it->second.size()) % MOD;
+			}
+		} else if (op < 17) {
+			// peek and count leave the order alone
+			auto it = c.peek(key);
+			auto jt = m.find(key);
+			check((it == c.cend()) == (jt == m.order.end()), "peek");
+			check(c.count(key) == size_t(jt != m.order.end()), "count");
+			if (jt != m.order.end()) check(it->second == jt->val, "peek value");
+		} else if (op < 18) {
+			auto jt = m.find(key);
+			try {
+				std::string &v = c.at(key);
+				check(jt != m.order.end() && v == jt->val, "at");
+				if (jt != m.order.end()) m.touch(jt);
+			} catch (sjtu::index_out_of_bound &) {
+				check(jt == m.order.end(), "at on a missing key");
+			}
+		} else if (op < 19 && step % 10 == 0) {
+			// shrink the budget, then give it back
+			size_t b = step % 20 ? 40 + rand() % 160 : 200;
+			c.set_budget(b);
+			m.cap = b;
+			m.shrink();
+			check(c.budget() == b, "budget");
+		}
+		check(same(c, m), "order and weight");
+		check(log == m.log, "eviction order");
+	}
+	cache d(c), e(1);
+	e = c;
+	check(same(d, m) && same(e, m), "copy");
+	std::cout << "evicted:" << log.size() << " size:" << c.size() << " weight:" << c.weight() << " hash:" << hash << std::endl;
+	result();
+}
+
+void test_edges() {
+	puts("Test: an element heavier than the budget, and budget zero");
+	cache c(10);
+	std::vector<int> log;
+	c.on_evict([&log](const int &k, std::string &) {
+		log.push_back(k);
+	});
+	c.insert(cache::value_type(1, "aaaa"));
+	c.insert(cache::value_type(2, "bbbb"));
+	// too heavy alone: evicted at once, the others stay
+	auto r = c.insert(cache::value_type(3, "ccccccccccc"));
+	check(r.second && r.first == c.end() && c.size() == 2 && !c.count(3), "too heavy");
+	// growing an element past the budget evicts just it
+	auto q = c.insert_or_assign(1, std::string(11, 'a'));
+	check(!q.second && q.first == c.end() && c.size() == 1 && c.weight() == 4, "grown past the budget");
+	// growing within the budget keeps both
+	c.insert(cache::value_type(4, "dd"));
+	c.insert_or_assign(4, std::string("dddddd"));
+	check(c.size() == 2 && c.weight() == 10 && c.cbegin()->first == 4, "grown within the budget");
+	c.insert_or_assign(2, std::string("bbbbb"));
+	check(c.size() == 1 && c.cbegin()->first == 2, "re-weighed and evicted the other");
+	c.set_budget(0);
+	check(c.empty() && c.weight() == 0, "budget zero");
+	c.insert(cache::value_type(5, ""));
+	check(c.size() == 1, "weight zero fits in budget zero");
+	for (int k : log)
+		std::cout << k << ' ';
+	puts("");
+	result();
+}
+
+int main() {
+	test_random();
+	test_edges();
+	return 0;
+}
@@ -0,0 +1,249 @@
+// concurrent_map and the optimistic reads of map, from several threads
+
+#include <iostream>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include "map.hpp"
+#include "epoch.hpp"
+#include "concurrent_map.hpp"
+
+std::atomic<bool> failed(false);
+void check(bool ok, const char *what) {
+	if (!ok && !failed.exchange(true))
+		std::cout << "wrong: " << what << std::endl;
+}
+void result() {
+	std::cout << (failed ? "fail" : "ok") << std::endl;
+	failed = false;
+}
+
+const int threads = 8;
+const int range = 40000;
+
+/*
+   a value that knows whether it is a copy kept by a map: counting those
+   that are destroyed tells how many nodes were really freed
+ */
+std::atomic<long> stored_freed(0);
+struct tracked {
+	int k;
+	bool stored;
+	explicit tracked(int k): k(k), stored(false) {}
+	tracked(const tracked &o): k(o.k), stored(true) {}
+	~tracked() {
+		if (stored) ++stored_freed;
+		k = -1;
+	}
+};
+
+void test_disjoint() {
+	puts("Test: concurrent_map, writers on their own keys and a reader");
+	sjtu::concurrent_map<int, int> m;
+	std::atomic<int> done(0);
+	std::vector<std::thread> ws;
+	for (int t = 0; t < threads; ++t) {
+		ws.push_back(std::thread([&m, &done, t] {
+			for (int k = t; k < range; k += threads)
+				check(m.insert(sjtu::pair<const int, int>(k, k * 3)).second, "insert");
+			for (int k = t; k < range; k += threads)
+				if (k % 3 == 0)
+					check(m.erase(k) == 1, "erase");
+			for (int k = t; k < range; k += threads) {
+				check(m.count(k) == size_t(k % 3 != 0), "count");
+				if (k % 9 == 0)
+					check(m.insert(sjtu::pair<const int, int>(k, k * 3)).second, "insert again");
+			}
+			++done;
+		}));
+	}
+	std::thread reader([&m, &done] {
+		while (done < threads) {
+			int last = -1;
+			for (auto it = m.cbegin(); it != m.cend(); ++it) {
+				check(it->first > last, "order");
+				check(it->second == it->first * 3, "value");
+				last = it->first;
+			}
+		}
+	});
+	for (auto &w : ws)
+		w.join();
+	reader.join();
+	long long sum = 0;
+	for (auto it = m.cbegin(); it != m.cend(); ++it)
+		sum += it->first;
+	std::cout << "size:" << m.size() << " sum:" << sum << std::endl;
+	result();
+}
+
+void test_same_keys() {
+	puts("Test: concurrent_map, writers racing on the same keys");
+	sjtu::concurrent_map<int, int> m;
+	std::atomic<int> inserted(0), erased(0);
+	for (int phase = 0; phase < 3; ++phase) {
+		std::vector<std::thread> ws;
+		for (int t = 0; t < threads; ++t) {
+			ws.push_back(std::thread([&m, &inserted, &erased, phase] {
+				if (phase == 0) {
+					for (int k = 0; k < 5000; ++k)
+						if (m.insert(sjtu::pair<const int, int>(k, k)).second)
+							++inserted;
+				} else if (phase == 1) {
+					for (int k = 0; k < 5000; k += 2)
+						erased += m.erase(k);
+				} else {
+					for (int k = 0; k < 5000; ++k)
+						check(m.count(k) == size_t(k & 1), "count");
+					for (int k = 1; k < 5000; k += 2)
+						check(m.at(k) == k, "at");
+				}
+			}));
+		}
+		for (auto &w : ws)
+			w.join();
+	}
+	std::cout << "inserted:" << inserted << " erased:" << erased << " size:" << m.size() << std::endl;
+	result();
+}
+
+void test_optimistic() {
+	puts("Test: optimistic reads beside a writer");
+	sjtu::map<int, int> m;
+	m.optimistic_reads(true);
+	for (int k = 0; k < range; k += 2)
+		m.insert(sjtu::pair<const int, int>(k, k * 7));
+	std::atomic<bool> done(false);
+	std::vector<std::thread> rs;
+	for (int t = 0; t < threads - 1; ++t) {
+		rs.push_back(std::thread([&m, &done, t] {
+			unsigned x = t + 1;
+			while (!done) {
+				x ^= x << 13;
+				x ^= x >> 17;
+				x ^= x << 5;
+				int k = x % range, v;
+				if (m.optimistic_find(k, v))
+					check(v == k * 7, "optimistic_find");
+				if (m.optimistic_count(k)) {
+					try {
+						check(m.optimistic_at(k) == k * 7, "optimistic_at");
+					} catch (sjtu::index_out_of_bound &) {
+						// erased in between
+					}
+				}
+			}
+		}));
+	}
+	for (int round = 0; round < 4; ++round) {
+		for (int k = 1; k < range; k += 2)
+			m.insert(sjtu::pair<const int, int>(k, k * 7));
+		for (int k = 0; k < range; k += 3)
+			m.erase(k);
+		for (int k = 0; k < range; k += 3)
+			m.insert_or_assign(k, k * 7);
+	}
+	m.erase(m.begin(), m.begin() + 1000);
+	done = true;
+	for (auto &r : rs)
+		r.join();
+	long long sum = 0;
+	for (auto &kv : m)
+		sum += kv.second;
+	std::cout << "size:" << m.size() << " sum:" << sum << std::endl;
+	result();
+}
+
+void test_churn() {
+	puts("Test: concurrent_map, erase and find on a few hot keys");
+	typedef sjtu::concurrent_map<int, tracked> map;
+	map m;
+	std::atomic<long> calls(0);
+	std::atomic<int> done(0);
+	long before = stored_freed;
+	std::vector<std::thread> ts;
+	for (int t = 0; t < threads / 2; ++t) {
+		ts.push_back(std::thread([&m, &calls, &done, t] {
+			unsigned x = t + 7;
+			for (int i = 0; i < 100000; ++i) {
+				x ^= x << 13;
+				x ^= x >> 17;
+				x ^= x << 5;
+				int k = x % 256;
+				if (!m.erase(k)) {
+					m.insert(map::value_type(k, tracked(k)));
+					++calls;
+				}
+			}
+			++done;
+		}));
+	}
+	for (int t = 0; t < threads / 2; ++t) {
+		ts.push_back(std::thread([&m, &done, t] {
+			unsigned x = t + 100;
+			while (done < threads / 2) {
+				x ^= x << 13;
+				x ^= x >> 17;
+				x ^= x << 5;
+				int k = x % 256;
+				map::const_iterator it = m.find(k);
+				if (it != m.cend())
+					check(it->second.k == k, "find on a hot key");
+			}
+		}));
+	}
+	for (auto &t : ts)
+		t.join();
+	// every insert call destroys one stored copy of its own argument
+	std::cout << "freed while reading:" << (stored_freed - before - calls > 0 ? "yes" : "no") << std::endl;
+	result();
+}
+
+void test_optimistic_churn() {
+	puts("Test: optimistic reads while nodes are freed");
+	typedef sjtu::map<int, tracked> map;
+	map m;
+	m.optimistic_reads(true);
+	std::atomic<bool> done(false);
+	long before = stored_freed, calls = 0;
+	std::vector<std::thread> rs;
+	for (int t = 0; t < threads - 1; ++t) {
+		rs.push_back(std::thread([&m, &done, t] {
+			unsigned x = t + 1;
+			while (!done) {
+				x ^= x << 13;
+				x ^= x >> 17;
+				x ^= x << 5;
+				m.optimistic_count(x % 512);
+			}
+		}));
+	}
+	unsigned x = 99;
+	for (int i = 0; i < 400000; ++i) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		int k = x % 512;
+		if (!m.erase(k)) {
+			m.insert(map::value_type(k, tracked(k)));
+			++calls;
+		}
+	}
+	std::cout << "freed while reading:" << (stored_freed - before - calls > 0 ? "yes" : "no") << std::endl;
+	done = true;
+	for (auto &r : rs)
+		r.join();
+	for (int k = 0; k < 512; ++k)
+		check(m.count(k) == (m.find(k) != m.end() ? 1u : 0u) && (!m.count(k) || m.at(k).k == k), "values");
+	result();
+}
+
+int main() {
+	test_disjoint();
+	test_same_keys();
+	test_optimistic();
+	test_churn();
+	test_optimistic_churn();
+	return 0;
+}
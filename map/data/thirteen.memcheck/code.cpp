@@ -0,0 +1,154 @@
+// flat_map: insert_range and the sorted_unique constructor against std::map
+
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <vector>
+#include "flat_map.hpp"
+
+long long aa = 13131, bb = 5353, MOD = (long long)(1e9 + 7), now = 1;
+int rand() {
+	for (int i = 1; i < 3; i++)
+		now = (now * aa + bb) % MOD;
+	return now;
+}
+
+bool failed = false;
+void check(bool ok, const char *what) {
+	if (!ok && !failed) {
+		std::cout << "wrong: " << what << std::endl;
+		failed = true;
+	}
+}
+void result() {
+	std::cout << (failed ? "fail" : "ok") << std::endl;
+	failed = false;
+}
+
+typedef sjtu::flat_map<int, int> map;
+typedef sjtu::pair<int, int> item;
+
+template<class Std>
+bool same(const map &m, const Std &s) {
+	if (m.size() != s.size()) return false;
+	auto it = m.cbegin();
+	for (auto &kv : s) {
+		if ((*it).first != kv.first || (*it).second != kv.second)
+			return false;
+		++it;
+	}
+	return it == m.cend();
+}
+/*
+   what insert_range should give: the old elements stay,
+   the first of the range wins among its equal keys
+ */
+void insert_first(std::map<int, int> &s, const std::vector<item> &v) {
+	for (auto &x : v)
+		s.insert(std::make_pair(x.first, x.second));
+}
+
+/*
+   a single pass over a vector, like an istream_iterator: every copy
+   shares one position, so nothing can be read twice
+ */
+class one_pass {
+	const std::vector<item> *v;
+	size_t *pos;
+public:
+	one_pass(): v(0), pos(0) {}
+	one_pass(const std::vector<item> &v, size_t *pos): v(&v), pos(pos) {}
+	const item& operator*() const {
+		return (*v)[*pos];
+	}
+	one_pass& operator++() {
+		++*pos;
+		return *this;
+	}
+	bool operator!=(const one_pass &o) const {
+		bool a = !pos || *pos == v->size(), b = !o.pos || *o.pos == o.v->size();
+		return !(a && b);
+	}
+};
+
+void test_insert_range() {
+	puts("Test: insert_range with repeated and existing keys");
+	map m;
+	std::map<int, int> s;
+	long long hash = 0;
+	for (int round = 0; round < 300; ++round) {
+		std::vector<item> v;
+		int len = rand() % 60, range = 1 + rand() % 400;
+		for (int i = 0; i < len; ++i)
+			v.push_back(item(rand() % range, round * 100 + i));
+		if (round % 3 == 0) {
+			size_t pos = 0;
+			m.insert_range(one_pass(v, &pos), one_pass());
+			check(pos == v.size(), "one pass");
+		} else {
+			m.insert_range(v.begin(), v.end());
+		}
+		insert_first(s, v);
+		check(same(m, s), "insert_range");
+		if (round % 7 == 0 && !s.empty()) {
+			for (int i = 0; i < 10 && !s.empty(); ++i) {
+				auto it = m.lower_bound(rand() % 400);
+				if (it == m.end()) continue;
+				s.erase((*it).first);
+				m.erase(it);
+			}
+			check(same(m, s), "erase between ranges");
+		}
+	}
+	m.insert_range(m.cend(), m.cend());
+	check(same(m, s), "empty range");
+	for (auto &kv : s)
+		hash = (hash * 31 + kv.second) % MOD;
+	std::cout << "size:" << s.size() << " hash:" << hash << std::endl;
+	result();
+}
+
+void test_sorted_unique() {
+	puts("Test: the sorted_unique constructor on sorted and unsorted input");
+	long long hash = 0;
+	for (int round = 0; round < 200; ++round) {
+		std::vector<int> k, x;
+		int len = rand() % 80;
+		for (int i = 0; i < len; ++i) {
+			k.push_back(i * 3);
+			x.push_back(rand() % 1000);
+		}
+		// sorted, then spoiled in a few places: a repeat, a swap, a smaller tail
+		if (round % 4 == 1 && len > 2) k[len / 2] = k[len / 2 - 1];
+		if (round % 4 == 2 && len > 2) std::swap(k[0], k[len - 1]);
+		if (round % 4 == 3) {
+			for (int i = 0; i < 5; ++i) {
+				k.push_back(rand() % (len * 3 + 1));
+				x.push_back(-1);
+			}
+		}
+		std::vector<item> v;
+		for (size_t i = 0; i < k.size(); ++i)
+			v.push_back(item(k[i], x[i]));
+		std::map<int, int> s;
+		insert_first(s, v);
+		map a(sjtu::sorted_unique, v.begin(), v.end());
+		check(same(a, s), "sorted_unique");
+		size_t pos = 0;
+		map b(sjtu::sorted_unique, one_pass(v, &pos), one_pass());
+		check(same(b, s) && pos == v.size(), "sorted_unique from one pass");
+		for (auto &kv : s)
+			hash = (hash * 31 + kv.second) % MOD;
+	}
+	std::vector<item> none;
+	map e(sjtu::sorted_unique, none.begin(), none.end());
+	check(e.empty() && e.begin() == e.end(), "empty");
+	std::cout << "hash:" << hash << std::endl;
+	result();
+}
+
+int main() {
+	test_insert_range();
+	test_sorted_unique();
+	return 0;
+}
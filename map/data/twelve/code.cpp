@@ -0,0 +1,209 @@
+// unordered_map against std::map, with long probe runs to shift back on erase
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <map>
+#include "unordered_map.hpp"
+
+long long aa = 13131, bb = 5353, MOD = (long long)(1e9 + 7), now = 1;
+int rand() {
+	for (int i = 1; i < 3; i++)
+		now = (now * aa + bb) % MOD;
+	return now;
+}
+
+bool failed = false;
+void check(bool ok, const char *what) {
+	if (!ok && !failed) {
+		std::cout << "wrong: " << what << std::endl;
+		failed = true;
+	}
+}
+void result() {
+	std::cout << (failed ? "fail" : "ok") << std::endl;
+	failed = false;
+}
+
+/*
+   eight keys share every hash, so runs get long and erase has to
+   move elements back across them
+ */
+struct crowded {
+	size_t operator()(int x) const {
+		return x / 8;
+	}
+};
+
+/*
+   every element exactly once, with the value of the std::map
+ */
+template<class Map, class Std>
+bool same(const Map &m, const Std &s) {
+	if (m.size() != s.size()) return false;
+	std::map<typename Std::key_type, int> seen;
+	for (auto it = m.cbegin(); it != m.cend(); ++it) {
+		auto jt = s.find(it->first);
+		if (jt == s.end() || jt->second != it->second || seen[it->first]++)
+			return false;
+	}
+	return seen.size() == s.size();
+}
+
+template<class Hash>
+void test_churn(const char *name) {
+	typedef sjtu::unordered_map<int, int, Hash> map;
+	std::cout << "Test: " << name << std::endl;
+	map m;
+	std::map<int, int> s;
+	long long hash = 0;
+	for (int step = 0; step < 200000; ++step) {
+		int op = rand() % 10, key = rand() % 3000;
+		if (op < 4) {
+			bool in = m.insert(typename map::value_type(key, step)).second;
+			check(in == s.insert(std::make_pair(key, step)).second, "insert");
+		} else if (op < 8) {
+			auto it = m.find(key);
+			auto jt = s.find(key);
+			check((it == m.end()) == (jt == s.end()), "find before erase");
+			if (jt != s.end()) {
+				m.erase(it);
+				s.erase(jt);
+			}
+		} else {
+			auto it = m.find(key);
+			check(m.count(key) == s.count(key), "count");
+			if (it != m.end()) {
+				check(it->second == s[key], "value");
+				hash = (hash * 31 + it->second) % MOD;
+			}
+		}
+		check(m.size() == s.size(), "size");
+		if (step % 9973 == 0) check(same(m, s), "every element once");
+	}
+	for (auto &kv : s)
+		check(m.at(kv.first) == kv.second, "at after churn");
+	check(same(m, s), "every element once");
+	std::cout << "size:" << s.size() << " hash:" << hash << std::endl;
+	result();
+}
+
+void test_growth() {
+	puts("Test: rehash while growing, clear and reuse");
+	sjtu::unordered_map<int, int> m;
+	std::map<int, int> s;
+	size_t grew = 0, cap = m.capacity();
+	for (int round = 0; round < 3; ++round) {
+		for (int i = 0; i < 50000; ++i) {
+			int key = rand() % 1000000;
+			m[key] = i;
+			s[key] = i;
+			if (m.capacity() != cap) {
+				check(m.capacity() > cap, "capacity only grows");
+				cap = m.capacity();
+				++grew;
+				for (auto &kv : s)
+					if (kv.first % 97 == 0) check(m.count(kv.first), "found after rehash");
+			}
+		}
+		check(same(m, s), "after growth");
+		m.clear();
+		s.clear();
+		check(m.empty() && m.begin() == m.end() && !m.count(0), "clear");
+		cap = m.capacity();
+	}
+	m.reserve(1000);
+	cap = m.capacity();
+	for (int i = 0; i < 1000; ++i)
+		m[i * 7] = i;
+	check(m.capacity() == cap, "reserve");
+	std::cout << "rehashed:" << grew << " size:" << m.size() << std::endl;
+	result();
+}
+
+void test_copy() {
+	puts("Test: copy and assignment");
+	typedef sjtu::unordered_map<int, int, crowded> map;
+	map m;
+	std::map<int, int> s;
+	for (int i = 0; i < 5000; ++i) {
+		int key = rand() % 8000;
+		m.insert(map::value_type(key, i));
+		s.insert(std::make_pair(key, i));
+	}
+	map c(m), d, e;
+	d = m;
+	e[1] = 1;
+	e = m;
+	check(same(c, s) && same(d, s) && same(e, s), "copies");
+	for (auto &kv : s)
+		if (kv.first % 2) m.erase(m.find(kv.first));
+	c = c;
+	check(same(c, s) && same(d, s), "copies after erase in the source");
+	map empty;
+	c = empty;
+	check(c.empty() && c.begin() == c.end(), "assign an empty map");
+	std::cout << "size:" << m.size() << std::endl;
+	result();
+}
+
+/*
+   looks up std::string keys by const char* without building a string
+ */
+struct text_hash {
+	typedef void is_transparent;
+	size_t operator()(const std::string &s) const {
+		return (*this)(s.c_str());
+	}
+	size_t operator()(const char *p) const {
+		size_t h = 0;
+		for (; *p; ++p)
+			h = h * 131 + *p;
+		return h;
+	}
+};
+struct text_equal {
+	typedef void is_transparent;
+	bool operator()(const std::string &a, const std::string &b) const {
+		return a == b;
+	}
+	bool operator()(const std::string &a, const char *b) const {
+		return !strcmp(a.c_str(), b);
+	}
+};
+
+void test_transparent() {
+	puts("Test: lookup by const char*");
+	sjtu::unordered_map<std::string, int, text_hash, text_equal> m;
+	for (int i = 0; i < 2000; i += 2)
+		m[std::to_string(i)] = i;
+	char buf[16];
+	int found = 0;
+	for (int i = 0; i < 2000; ++i) {
+		snprintf(buf, sizeof(buf), "%d", i);
+		const char *p = buf;
+		check(m.count(p) == size_t(i % 2 == 0), "count");
+		auto it = m.find(p);
+		if (it != m.end()) {
+			check(it->second == i && m.at(p) == i, "find");
+			++found;
+		} else {
+			try {
+				m.at(p);
+				check(false, "at on a missing key");
+			} catch (sjtu::index_out_of_bound &) {}
+		}
+	}
+	std::cout << "found:" << found << std::endl;
+	result();
+}
+
+int main() {
+	test_churn<std::hash<int>>("random insert and erase");
+	test_churn<crowded>("insert and erase, eight keys to a hash");
+	test_growth();
+	test_copy();
+	test_transparent();
+	return 0;
+}
@@ -0,0 +1,245 @@
+/**
+ * implement epoch based reclamation for the concurrent maps
+ */
+#ifndef SJTU_EPOCH_HPP
+#define SJTU_EPOCH_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+namespace sjtu {
+
+/**
+ * deferred freeing of memory that readers may still be looking at.
+ *
+ * a reader holds an epoch::guard while it follows pointers, a writer that
+ *   has made a block unreachable passes it to retire() instead of freeing it.
+ * there is one global epoch. a thread is pinned at the epoch it read
+ *   when its first guard was made, and the epoch only moves on once every
+ *   pinned thread has caught up with it. a block retired at epoch e is freed
+ *   once the epoch reaches e + 2: by then nobody can still hold a pointer
+ *   read before the block was unlinked.
+ *
+ * pinning writes only to the thread's own record (a cache line of its own),
+ *   so readers do not share any line they write to.
+ * a guard belongs to the thread that made it. holding one for long
+ *   (say in a stored iterator) delays freeing for every thread.
+ */
+class epoch {
+private:
+	struct retired {
+		void *p;
+		void (*del)(void*);
+	};
+	/*
+	   the blocks a thread retired during one epoch
+	 */
+	struct bag {
+		retired *a;
+		size_t n, cap;
+		unsigned long tag;
+
+		bag(): a(0), n(0), cap(0), tag(0) {}
+		~bag() {
+			free_all();
+			delete [] a;
+		}
+		void push(void *p, void (*del)(void*)) {
+			if (n == cap) {
+				size_t c = cap ? cap * 2 : 32;
+				retired *b = new retired[c];
+				for (size_t i = 0; i < n; ++i)
+					b[i] = a[i];
+				delete [] a;
+				a = b;
+				cap = c;
+			}
+			a[n].p = p;
+			a[n].del = del;
+			++n;
+		}
+		void free_all() {
+			for (size_t i = 0; i < n; ++i)
+				a[i].del(a[i].p);
+			n = 0;
+		}
+	};
+	/*
+	   records are placed on whole cache lines by make(): new on an over
+	   aligned type only aligns from C++17 on
+	 */
+	struct record {
+		std::atomic<unsigned long> state; // epoch << 1 | pinned
+		std::atomic<bool> busy;
+		record *next;
+		int nest;
+		unsigned tick;
+		bag bags[3];
+		void *raw; // the block it sits in
+
+		explicit record(void *raw): state(0), busy(true), next(0), nest(0), tick(0), raw(raw) {}
+
+		static const size_t line = 64;
+		static record* make() {
+			size_t size = (sizeof(record) + line - 1) / line * line;
+			char *raw = static_cast<char*>(::operator new(size + line));
+			char *p = raw + (line - size_t(raw) % line) % line;
+			return new (p) record(raw);
+		}
+		static void destroy(record *r) {
+			void *raw = r->raw;
+			r->~record();
+			::operator delete(raw);
+		}
+	};
+	struct domain {
+		std::atomic<unsigned long> now;
+		std::atomic<record*> head;
+
+		domain(): now(2), head(0) {}
+		/*
+		   at exit no thread is left to read anything
+		 */
+		~domain() {
+			for (record *r = head.load(), *t; r; r = t) {
+				t = r->next;
+				record::destroy(r);
+			}
+		}
+		record* acquire() {
+			for (record *r = head.load(std::memory_order_acquire); r; r = r->next) {
+				bool f = false;
+				if (!r->busy.load(std::memory_order_relaxed) && r->busy.compare_exchange_strong(f, true))
+					return r; // the bags of a finished thread come with it
+			}
+			record *r = record::make();
+			record *h = head.load(std::memory_order_relaxed);
+			do r->next = h;
+			while (!head.compare_exchange_weak(h, r, std::memory_order_release, std::memory_order_relaxed));
+			return r;
+		}
+		/*
+		   move on only if every pinned thread is at the current epoch
+		 */
+		void try_advance() {
+			unsigned long e = now.load();
+			for (record *r = head.load(std::memory_order_acquire); r; r = r->next) {
+				unsigned long s = r->state.load();
+				if ((s & 1) && (s >> 1) != e)
+					return;
+			}
+			now.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel, std::memory_order_relaxed);
+		}
+	};
+	/*
+	   gives the record back when the thread ends
+	 */
+	struct owner {
+		record *r;
+
+		owner(): r(global().acquire()) {}
+		~owner() {
+			r->busy.store(false, std::memory_order_release);
+		}
+	};
+
+	static domain& global() {
+		static domain d;
+		return d;
+	}
+	static record* local() {
+		static thread_local owner o;
+		return o.r;
+	}
+	/*
+	   the epoch may move between reading it and publishing the pin, then
+	   the pin is stale and advancing would not wait for it: pin again until
+	   the epoch read after publishing is the one published
+	 */
+	static void pin(record *r) {
+		if (r->nest++) return;
+		domain &d = global();
+		unsigned long e = d.now.load(), f;
+		for (;;) {
+			// a full barrier: the reads that follow may not pass it
+			r->state.exchange(e << 1 | 1);
+			if ((f = d.now.load()) == e) return;
+			e = f;
+		}
+	}
+	static void unpin(record *r) {
+		if (!--r->nest)
+			r->state.store(0, std::memory_order_release);
+	}
+
+public:
+	/**
+	 * pins the current thread while it lives. guards nest and copy freely
+	 *   within one thread.
+	 */
+	class guard {
+	public:
+		guard(): r(local()) {
+			pin(r);
+		}
+		guard(const guard &o): r(o.r) {
+			pin(r);
+		}
+		guard& operator=(const guard &o) {
+			pin(o.r);
+			unpin(r);
+			r = o.r;
+			return *this;
+		}
+		~guard() {
+			unpin(r);
+		}
+
+	private:
+		record *r;
+	};
+
+	/**
+	 * free p with del(p) once no thread can still reach it.
+	 *   the caller must hold a guard and p must already be unreachable.
+	 * the block is stamped with the global epoch read after it was made
+	 *   unreachable, not with the caller's pin, which may be behind it:
+	 *   only readers pinned at that epoch or before can hold it.
+	 */
+	static void retire(void *p, void (*del)(void*)) {
+		domain &d = global();
+		record *r = local();
+		unsigned long e = d.now.load();
+		bag &b = r->bags[e % 3];
+		if (b.tag != e) {
+			// retired at e - 3 or before
+			b.free_all();
+			b.tag = e;
+		}
+		b.push(p, del);
+		if (++r->tick % 64) return;
+		d.try_advance();
+		unsigned long now = d.now.load(std::memory_order_acquire);
+		for (int i = 0; i < 3; ++i)
+			if (r->bags[i].n && r->bags[i].tag + 2 <= now)
+				r->bags[i].free_all();
+	}
+	/**
+	 * retire a block from new T.
+	 */
+	template<class T>
+	static void retire(T *p) {
+		retire(p, &destroy<T>);
+	}
+
+private:
+	template<class T>
+	static void destroy(void *p) {
+		delete static_cast<T*>(p);
+	}
+};
+
+}
+
+#endif
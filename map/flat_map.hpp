@@ -0,0 +1,481 @@
+/**
+ * implement a container like std::flat_map
+ */
+#ifndef SJTU_FLAT_MAP_HPP
+#define SJTU_FLAT_MAP_HPP
+
+// only for std::less<T>
+#include <functional>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "utility.hpp"
+#include "exceptions.hpp"
+
+namespace sjtu {
+
+/**
+ * a map kept as two sorted arrays, one of keys and one of values.
+ *
+ * a lookup is a binary search over the keys alone, which for a few dozen
+ *   elements is one or two cache lines. insert and erase move the tail
+ *   of both arrays, so it suits maps that are small or mostly read.
+ *
+ * like std::flat_map the elements are not stored as pairs:
+ *   *it is a pair<const Key&, T&> made on the fly, so write
+ *   for (auto kv : m) or for (auto &&kv : m), not for (auto &kv : m).
+ * iterators are a key pointer and a value pointer and are not checked,
+ *   insert and erase invalidate them.
+ */
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>
+> class flat_map {
+public:
+	/**
+	 * the type taken by insert.
+	 */
+	typedef pair<const Key, T> value_type;
+
+	/**
+	 * a random access iterator over the two arrays,
+	 *   V is T for iterator and const T for const_iterator.
+	 */
+	template<class V>
+	class base_iterator {
+		friend class flat_map;
+		template<class W> friend class base_iterator;
+	public:
+		typedef pair<const Key&, V&> reference;
+		struct pointer {
+			reference r;
+			reference* operator->() {
+				return &r;
+			}
+		};
+	private:
+		const Key *k;
+		V *v;
+
+	public:
+		base_iterator(): k(0), v(0) {}
+		base_iterator(const Key *k, V *v): k(k), v(v) {}
+		template<class W>
+		base_iterator(const base_iterator<W> &other): k(other.k), v(other.v) {}
+
+		base_iterator operator+(ptrdiff_t n) const {
+			return base_iterator(k + n, v + n);
+		}
+		base_iterator operator-(ptrdiff_t n) const {
+			return base_iterator(k - n, v - n);
+		}
+		base_iterator& operator+=(ptrdiff_t n) {
+			k += n;
+			v += n;
+			return *this;
+		}
+		base_iterator& operator-=(ptrdiff_t n) {
+			k -= n;
+			v -= n;
+			return *this;
+		}
+		template<class W>
+		ptrdiff_t operator-(const base_iterator<W> &rhs) const {
+			return k - rhs.k;
+		}
+		base_iterator operator++(int) {
+			base_iterator tmp = *this;
+			++k;
+			++v;
+			return tmp;
+		}
+		base_iterator& operator++() {
+			++k;
+			++v;
+			return *this;
+		}
+		base_iterator operator--(int) {
+			base_iterator tmp = *this;
+			--k;
+			--v;
+			return tmp;
+		}
+		base_iterator& operator--() {
+			--k;
+			--v;
+			return *this;
+		}
+		reference operator*() const {
+			return reference(*k, *v);
+		}
+		pointer operator->() const {
+			pointer p = {**this};
+			return p;
+		}
+		reference operator[](ptrdiff_t n) const {
+			return reference(k[n], v[n]);
+		}
+		template<class W>
+		bool operator==(const base_iterator<W> &rhs) const {
+			return k == rhs.k;
+		}
+		template<class W>
+		bool operator!=(const base_iterator<W> &rhs) const {
+			return k != rhs.k;
+		}
+		template<class W>
+		bool operator<(const base_iterator<W> &rhs) const {
+			return k < rhs.k;
+		}
+		template<class W>
+		bool operator>(const base_iterator<W> &rhs) const {
+			return k > rhs.k;
+		}
+		template<class W>
+		bool operator<=(const base_iterator<W> &rhs) const {
+			return k <= rhs.k;
+		}
+		template<class W>
+		bool operator>=(const base_iterator<W> &rhs) const {
+			return k >= rhs.k;
+		}
+	};
+	typedef base_iterator<T> iterator;
+	typedef base_iterator<const T> const_iterator;
+	/**
+	 * two constructors
+	 */
+	flat_map(): keys(0), vals(0), n(0), cap(0) {}
+	flat_map(const flat_map &o): keys(0), vals(0), n(0), cap(0), cmp(o.cmp) {
+		copy(o);
+	}
+	/**
+	 * build from a range sorted by key in O(n).
+	 * the first element out of order (or with a repeated key) and everything
+	 *   after it go through insert_range, so unsorted input still gives the
+	 *   right map.
+	 */
+	template<class InputIterator>
+	flat_map(sorted_unique_t, InputIterator first, InputIterator last): keys(0), vals(0), n(0), cap(0) {
+		for (; first != last; ++first) {
+			if (n && !cmp(keys[n - 1], (*first).first))
+				break;
+			if (n == cap) grow(n, cap ? cap * 2 : 4);
+			new (keys + n) Key((*first).first);
+			new (vals + n) T((*first).second);
+			++n;
+		}
+		insert_range(first, last);
+	}
+	/**
+	 * assignment operator
+	 */
+	flat_map& operator=(const flat_map &o) {
+		if (this == &o) {
+			return *this;
+		}
+		clear();
+		cmp = o.cmp;
+		copy(o);
+		return *this;
+	}
+	/**
+	 * Destructors
+	 */
+	~flat_map() {
+		clear();
+		release();
+	}
+	/**
+	 * access specified element with bounds checking
+	 * Returns a reference to the mapped value of the element with key equivalent to key.
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	T& at(const Key &key) {
+		size_t i = lower_index(key);
+		if (i == n || cmp(key, keys[i]))
+			throw index_out_of_bound();
+		return vals[i];
+	}
+	const T& at(const Key &key) const {
+		size_t i = lower_index(key);
+		if (i == n || cmp(key, keys[i]))
+			throw index_out_of_bound();
+		return vals[i];
+	}
+	/**
+	 * access specified element
+	 * Returns a reference to the value that is mapped to a key equivalent to key,
+	 *   performing an insertion if such key does not already exist.
+	 */
+	T & operator[](const Key &key) {
+		size_t i = lower_index(key);
+		if (i == n || cmp(key, keys[i]))
+			put(i, key, T());
+		return vals[i];
+	}
+	/**
+	 * behave like at() throw index_out_of_bound if such key does not exist.
+	 */
+	const T & operator[](const Key &key) const {
+		return at(key);
+	}
+	/**
+	 * return a iterator to the beginning
+	 */
+	iterator begin() {
+		return iterator(keys, vals);
+	}
+	const_iterator cbegin() const {
+		return const_iterator(keys, vals);
+	}
+	/**
+	 * return a iterator to the end
+	 * in fact, it returns past-the-end.
+	 */
+	iterator end() {
+		return iterator(keys + n, vals + n);
+	}
+	const_iterator cend() const {
+		return const_iterator(keys + n, vals + n);
+	}
+	/**
+	 * checks whether the container is empty
+	 * return true if empty, otherwise false.
+	 */
+	bool empty() const {
+		return !n;
+	}
+	/**
+	 * returns the number of elements.
+	 */
+	size_t size() const {
+		return n;
+	}
+	size_t capacity() const {
+		return cap;
+	}
+	/**
+	 * clears the contents, the arrays are kept for reuse
+	 */
+	void clear() {
+		for (size_t i = 0; i < n; ++i) {
+			keys[i].~Key();
+			vals[i].~T();
+		}
+		n = 0;
+	}
+	void reserve(size_t c) {
+		if (c > cap) grow(n, c);
+	}
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<iterator, bool> insert(const value_type &value) {
+		size_t i = lower_index(value.first);
+		if (i < n && !cmp(value.first, keys[i]))
+			return pair<iterator, bool>(iterator(keys + i, vals + i), false);
+		put(i, value.first, value.second);
+		return pair<iterator, bool>(iterator(keys + i, vals + i), true);
+	}
+	/**
+	 * insert every element of [first, last) whose key is not in the map yet
+	 *   (the first one wins among equal keys of the range).
+	 * the range is appended, sorted on its own and merged with the old
+	 *   elements once: O(n + m log m) instead of m shifts of the arrays.
+	 */
+	template<class InputIterator>
+	void insert_range(InputIterator first, InputIterator last) {
+		size_t m = 0;
+		for (; first != last; ++first, ++m) {
+			if (n + m == cap) grow(n + m, cap ? cap * 2 : 4);
+			new (keys + n + m) Key((*first).first);
+			new (vals + n + m) T((*first).second);
+		}
+		if (!m) return;
+		size_t *ord = sort_order(keys + n, m);
+		Key *nk = static_cast<Key*>(::operator new((n + m) * sizeof(Key)));
+		T *nv = static_cast<T*>(::operator new((n + m) * sizeof(T)));
+		size_t i = 0, j = 0, out = 0;
+		while (i < n || j < m) {
+			// on equal keys the old element goes first and the new one is dropped
+			size_t s = j == m || (i < n && !cmp(keys[n + ord[j]], keys[i])) ? i++ : n + ord[j++];
+			if (out && !cmp(nk[out - 1], keys[s])) {
+				keys[s].~Key();
+				vals[s].~T();
+				continue;
+			}
+			relocate(keys + s, nk + out);
+			relocate(vals + s, nv + out);
+			++out;
+		}
+		delete [] ord;
+		release();
+		keys = nk;
+		vals = nv;
+		cap = n + m;
+		n = out;
+	}
+	/**
+	 * erase the element at pos.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(iterator pos) {
+		if (pos.k < keys || pos.k >= keys + n) throw invalid_iterator();
+		size_t i = pos.k - keys;
+		keys[i].~Key();
+		vals[i].~T();
+		for (--n; i < n; ++i) {
+			relocate(keys + i + 1, keys + i);
+			relocate(vals + i + 1, vals + i);
+		}
+	}
+	/**
+	 * Returns the number of elements with key
+	 *   that compares equivalent to the specified argument,
+	 *   which is either 1 or 0
+	 *     since this container does not allow duplicates.
+	 * The default method of check the equivalence is !(a < b || b > a)
+	 */
+	size_t count(const Key &key) const {
+		size_t i = lower_index(key);
+		return size_t(i < n && !cmp(key, keys[i]) ? 1 : 0);
+	}
+	/**
+	 * Finds an element with key equivalent to key.
+	 * key value of the element to search for.
+	 * Iterator to an element with key equivalent to key.
+	 *   If no such element is found, past-the-end (see end()) iterator is returned.
+	 */
+	iterator find(const Key &key) {
+		size_t i = lower_index(key);
+		if (i == n || cmp(key, keys[i])) return end();
+		return iterator(keys + i, vals + i);
+	}
+	const_iterator find(const Key &key) const {
+		size_t i = lower_index(key);
+		if (i == n || cmp(key, keys[i])) return cend();
+		return const_iterator(keys + i, vals + i);
+	}
+	/**
+	 * Returns an iterator to the first element whose key is not less than key,
+	 *   or end() if there is no such element.
+	 */
+	iterator lower_bound(const Key &key) {
+		size_t i = lower_index(key);
+		return iterator(keys + i, vals + i);
+	}
+	const_iterator lower_bound(const Key &key) const {
+		size_t i = lower_index(key);
+		return const_iterator(keys + i, vals + i);
+	}
+	/**
+	 * Returns an iterator to the first element whose key is greater than key,
+	 *   or end() if there is no such element.
+	 */
+	iterator upper_bound(const Key &key) {
+		size_t i = upper_index(key);
+		return iterator(keys + i, vals + i);
+	}
+	const_iterator upper_bound(const Key &key) const {
+		size_t i = upper_index(key);
+		return const_iterator(keys + i, vals + i);
+	}
+
+private:
+	Key *keys;
+	T *vals;
+	size_t n, cap;
+	Compare cmp;
+
+	void release() {
+		::operator delete(keys);
+		::operator delete(vals);
+	}
+	/*
+	   move the first live elements to arrays of c slots
+	 */
+	void grow(size_t live, size_t c) {
+		Key *nk = static_cast<Key*>(::operator new(c * sizeof(Key)));
+		T *nv = static_cast<T*>(::operator new(c * sizeof(T)));
+		for (size_t i = 0; i < live; ++i) {
+			relocate(keys + i, nk + i);
+			relocate(vals + i, nv + i);
+		}
+		release();
+		keys = nk;
+		vals = nv;
+		cap = c;
+	}
+	/*
+	   put a new element at i, the keys after it move one slot right
+	 */
+	void put(size_t i, const Key &key, const T &value) {
+		if (n == cap) grow(n, cap ? cap * 2 : 4);
+		for (size_t j = n; j > i; --j) {
+			relocate(keys + j - 1, keys + j);
+			relocate(vals + j - 1, vals + j);
+		}
+		new (keys + i) Key(key);
+		new (vals + i) T(value);
+		++n;
+	}
+	/*
+	   binary search without a branch on the comparison:
+	   the answer is always in [base, base + len]
+	 */
+	size_t lower_index(const Key &key) const {
+		if (!n) return 0;
+		const Key *base = keys;
+		for (size_t len = n; len > 1; len -= len / 2)
+			base = cmp(base[len / 2 - 1], key) ? base + len / 2 : base;
+		return base - keys + cmp(*base, key);
+	}
+	size_t upper_index(const Key &key) const {
+		if (!n) return 0;
+		const Key *base = keys;
+		for (size_t len = n; len > 1; len -= len / 2)
+			base = !cmp(key, base[len / 2 - 1]) ? base + len / 2 : base;
+		return base - keys + !cmp(key, *base);
+	}
+	/*
+	   indices of a[0, m) in key order, equal keys keep their order
+	 */
+	size_t* sort_order(const Key *a, size_t m) {
+		size_t *p = new size_t[m], *q = new size_t[m];
+		for (size_t i = 0; i < m; ++i)
+			p[i] = i;
+		for (size_t w = 1; w < m; w *= 2) {
+			for (size_t lo = 0; lo < m; lo += 2 * w) {
+				size_t mid = lo + w < m ? lo + w : m, hi = lo + 2 * w < m ? lo + 2 * w : m;
+				size_t i = lo, j = mid, o = lo;
+				while (i < mid && j < hi)
+					q[o++] = cmp(a[p[j]], a[p[i]]) ? p[j++] : p[i++];
+				while (i < mid) q[o++] = p[i++];
+				while (j < hi) q[o++] = p[j++];
+			}
+			size_t *t = p;
+			p = q;
+			q = t;
+		}
+		delete [] q;
+		return p;
+	}
+	void copy(const flat_map &o) {
+		if (o.n > cap) grow(0, o.n);
+		for (size_t i = 0; i < o.n; ++i) {
+			new (keys + i) Key(o.keys[i]);
+			new (vals + i) T(o.vals[i]);
+		}
+		n = o.n;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,290 @@
+/**
+ * implement a map from intervals with overlap queries
+ */
+#ifndef SJTU_INTERVAL_MAP_HPP
+#define SJTU_INTERVAL_MAP_HPP
+
+// only for std::less<T>
+#include <functional>
+#include <cstddef>
+#include <utility>
+#include "utility.hpp"
+#include "exceptions.hpp"
+#include "map.hpp"
+
+namespace sjtu {
+
+/**
+ * a map whose keys are closed intervals [first, second], like
+ *   sjtu::pair<int, int> for time ranges or a pair of addresses for an
+ *   ip range. an interval with second < first is empty and never found.
+ *
+ * the tree is a sjtu::map ordered by start, then by end. its Augment keeps
+ *   the largest end of every subtree, and node::update() pulls it like the
+ *   size, so it stays right through every rotation, split and join.
+ * overlapping(a, b) walks the tree in start order and skips any subtree
+ *   whose largest end is before a, stopping at the first start after b:
+ *   O(log n) to the first answer, then O(log n) at worst per answer.
+ * begin()/end() go through the thread of the map, in start order.
+ * Compare orders the points, it is default constructed inside the Augment.
+ * the queries walk the tree from map::tree_root().
+ */
+template<
+	class Interval,
+	class T,
+	class Compare = std::less<typename std::decay<decltype(Interval::first)>::type>
+> class interval_map {
+public:
+	typedef typename std::decay<decltype(Interval::first)>::type point_type;
+
+private:
+	/*
+	   intervals by start, then end
+	 */
+	struct by_start {
+		Compare c;
+
+		bool operator()(const Interval &x, const Interval &y) const {
+			if (c(x.first, y.first)) return true;
+			if (c(y.first, x.first)) return false;
+			return c(x.second, y.second);
+		}
+	};
+	/*
+	   the largest end, as a pointer into the key (keys never move),
+	   0 for no interval. empty intervals do not count
+	 */
+	struct max_end {
+		typedef const point_type *value_type;
+
+		static value_type identity() {
+			return 0;
+		}
+		static value_type of(const pair<const Interval, T> &e) {
+			return Compare()(e.first.second, e.first.first) ? 0 : &e.first.second;
+		}
+		static value_type combine(const value_type &l, const value_type &r) {
+			if (!l) return r;
+			if (!r) return l;
+			return Compare()(*l, *r) ? r : l;
+		}
+	};
+	typedef map<Interval, T, by_start, treap_balance, max_end> tree;
+	typedef typename tree::node node;
+
+public:
+	typedef typename tree::value_type value_type;
+	typedef typename tree::iterator iterator;
+	typedef typename tree::const_iterator const_iterator;
+
+	/**
+	 * walks the intervals that meet [a, b], in start order.
+	 *   a forward iterator, the default one is end().
+	 *
+	 * if there is anything wrong throw invalid_iterator.
+	 *     like ++ on end()
+	 */
+	template<class reference, class pointer>
+	class base_query {
+		friend class interval_map;
+	private:
+		const interval_map *self;
+		const node *o; // 0 when done
+		point_type a, b;
+
+		base_query(const interval_map *self, const point_type &a, const point_type &b): self(self), a(a), b(b) {
+			o = self->first(self->t.tree_root(), a, b);
+		}
+
+	public:
+		base_query(): self(0), o(0), a(), b() {}
+		/**
+		 * iter++
+		 */
+		base_query operator++(int) {
+			base_query tmp = *this;
+			++(*this);
+			return tmp;
+		}
+		/**
+		 * ++iter
+		 */
+		base_query& operator++() {
+			if (!o)
+				throw invalid_iterator();
+			o = self->next(o, a, b);
+			return *this;
+		}
+		reference operator*() const {
+			return *o->val;
+		}
+		pointer operator->() const noexcept {
+			return o->val;
+		}
+		/**
+		 * two queries compare equal at the same interval, every finished
+		 *   query is end().
+		 */
+		bool operator==(const base_query &rhs) const {
+			return o == rhs.o;
+		}
+		bool operator!=(const base_query &rhs) const {
+			return o != rhs.o;
+		}
+	};
+	typedef base_query<value_type&, value_type*> query_iterator;
+	typedef base_query<const value_type&, const value_type*> const_query_iterator;
+	typedef typename tree::template base_range<query_iterator> query_range;
+	typedef typename tree::template base_range<const_query_iterator> const_query_range;
+
+	interval_map() {}
+	/**
+	 * access specified element with bounds checking
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	T& at(const Interval &key) {
+		return t.at(key);
+	}
+	const T& at(const Interval &key) const {
+		return t.at(key);
+	}
+	/**
+	 * access specified element
+	 * inserts value_type(key, T()) if such key does not already exist.
+	 */
+	T& operator[](const Interval &key) {
+		return t[key];
+	}
+	const T& operator[](const Interval &key) const {
+		return t.at(key);
+	}
+	iterator begin() {
+		return t.begin();
+	}
+	const_iterator cbegin() const {
+		return t.cbegin();
+	}
+	iterator end() {
+		return t.end();
+	}
+	const_iterator cend() const {
+		return t.cend();
+	}
+	bool empty() const {
+		return t.empty();
+	}
+	size_t size() const {
+		return t.size();
+	}
+	void clear() {
+		t.clear();
+	}
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<iterator, bool> insert(const value_type &value) {
+		return t.insert(value);
+	}
+	template<class M>
+	pair<iterator, bool> insert_or_assign(const Interval &key, M &&obj) {
+		return t.insert_or_assign(key, std::forward<M>(obj));
+	}
+	/**
+	 * erase the element at pos.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(iterator pos) {
+		t.erase(pos);
+	}
+	size_t erase(const Interval &key) {
+		return t.erase(key);
+	}
+	size_t count(const Interval &key) const {
+		return t.count(key);
+	}
+	iterator find(const Interval &key) {
+		return t.find(key);
+	}
+	const_iterator find(const Interval &key) const {
+		return t.find(key);
+	}
+	/**
+	 * the intervals [s, e] with s <= b and a <= e, in start order.
+	 *   empty if b < a.
+	 */
+	query_range overlapping(const point_type &a, const point_type &b) {
+		return query_range(query_iterator(this, a, b), query_iterator());
+	}
+	const_query_range overlapping(const point_type &a, const point_type &b) const {
+		return const_query_range(const_query_iterator(this, a, b), const_query_iterator());
+	}
+	/**
+	 * the intervals that contain x, in start order.
+	 */
+	query_range stabbing(const point_type &x) {
+		return overlapping(x, x);
+	}
+	const_query_range stabbing(const point_type &x) const {
+		return overlapping(x, x);
+	}
+
+private:
+	tree t;
+	Compare cmp;
+
+	/*
+	   no interval in the subtree of o reaches a
+	 */
+	bool short_of(const node *o, const point_type &a) const {
+		const point_type *e = augment_field<max_end>::get(o);
+		return !e || cmp(*e, a);
+	}
+	/*
+	   the interval of o itself is not empty and reaches a
+	 */
+	bool reaches(const node *o, const point_type &a) const {
+		const point_type *e = max_end::of(*o->val);
+		return e && !cmp(*e, a);
+	}
+	/*
+	   the first interval meeting [a, b] in the subtree of o.
+	   once the left subtree reaches a it holds the answer if there is one:
+	   its first interval reaching a comes before everything else that does
+	 */
+	const node* first(const node *o, const point_type &a, const point_type &b) const {
+		while (o && !short_of(o, a)) {
+			if (!short_of(o->lc, a)) {
+				o = o->lc;
+				continue;
+			}
+			if (cmp(b, o->val->first.first)) return 0;
+			if (reaches(o, a)) return o;
+			o = o->rc;
+		}
+		return 0;
+	}
+	/*
+	   the next interval after x meeting [a, b]: its right subtree, then
+	   each ancestor x is left of, with the right subtree of that one
+	 */
+	const node* next(const node *x, const point_type &a, const point_type &b) const {
+		if (const node *y = first(x->rc, a, b)) return y;
+		for (;;) {
+			while (x->fa && x->fa->rc == x)
+				x = x->fa;
+			const node *p = x->fa;
+			if (!p || cmp(b, p->val->first.first)) return 0;
+			if (reaches(p, a)) return p;
+			if (const node *y = first(p->rc, a, b)) return y;
+			x = p;
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,377 @@
+/**
+ * implement a bounded map that evicts the least recently used element
+ */
+#ifndef SJTU_LRU_MAP_HPP
+#define SJTU_LRU_MAP_HPP
+
+// only for std::less<T>
+#include <functional>
+#include <cstddef>
+#include <utility>
+#include "utility.hpp"
+#include "exceptions.hpp"
+#include "map.hpp"
+
+namespace sjtu {
+
+/**
+ * default Weigher of lru_map: every element weighs 1, so the budget is
+ *   a number of elements.
+ * a Weigher returns the weight of an element, for a byte budget that
+ *   would be something like sizeof(Key) + v.size().
+ */
+struct unit_weight {
+	template<class Key, class T>
+	size_t operator()(const Key &, const T &) const {
+		return 1;
+	}
+};
+
+/**
+ * a cache: a map with a budget on the total weight of its elements.
+ *   when an insert goes over it, the least recently used elements are
+ *   evicted, each one passed to the eviction callback first.
+ *
+ * the index is a sjtu::map whose elements also carry the recency list,
+ *   so an element is a single allocation and sits in a single structure.
+ *   map elements never move, so the list links point at them directly.
+ * find and at move the element to the front by relinking pointers: a hit
+ *   costs one O(log n) descent and never allocates.
+ *   count, peek and iteration leave the order alone.
+ * iteration goes from the most to the least recently used.
+ */
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>,
+	class Weigher = unit_weight
+> class lru_map {
+private:
+	struct entry;
+	typedef pair<const Key, entry> elem;
+	struct entry {
+		T val;
+		elem *newer, *older;
+		size_t w;
+
+		template<class... Args>
+		explicit entry(Args&&... args): val(std::forward<Args>(args)...), newer(0), older(0), w(0) {}
+	};
+	typedef map<Key, entry, Compare> index;
+
+public:
+	typedef pair<const Key, T> value_type;
+
+	/**
+	 * see BidirectionalIterator at CppReference for help.
+	 *   V is T for iterator and const T for const_iterator,
+	 *   *it is a pair<const Key&, V&>.
+	 *
+	 * if there is anything wrong throw invalid_iterator.
+	 *     like it = cache.begin(); --it;
+	 *       or it = cache.end(); ++end();
+	 */
+	template<class V>
+	class base_iterator {
+		friend class lru_map;
+		template<class W> friend class base_iterator;
+	public:
+		typedef pair<const Key&, V&> reference;
+		struct pointer {
+			reference r;
+			reference* operator->() {
+				return &r;
+			}
+		};
+	private:
+		const lru_map *self;
+		elem *e; // 0 for end()
+
+	public:
+		base_iterator(): self(0), e(0) {}
+		base_iterator(const lru_map *self, elem *e): self(self), e(e) {}
+		template<class W>
+		base_iterator(const base_iterator<W> &o): self(o.self), e(o.e) {}
+		/**
+		 * iter++
+		 */
+		base_iterator operator++(int) {
+			base_iterator tmp = *this;
+			++(*this);
+			return tmp;
+		}
+		/**
+		 * ++iter, towards less recently used
+		 */
+		base_iterator& operator++() {
+			if (!e)
+				throw invalid_iterator();
+			e = e->second.older;
+			return *this;
+		}
+		/**
+		 * iter--
+		 */
+		base_iterator operator--(int) {
+			base_iterator tmp = *this;
+			--(*this);
+			return tmp;
+		}
+		/**
+		 * --iter
+		 */
+		base_iterator& operator--() {
+			if (!self)
+				throw invalid_iterator();
+			elem *p = e ? e->second.newer : self->tail;
+			if (!p)
+				throw invalid_iterator();
+			e = p;
+			return *this;
+		}
+		reference operator*() const {
+			return reference(e->first, e->second.val);
+		}
+		pointer operator->() const {
+			pointer p = {**this};
+			return p;
+		}
+		template<class W>
+		bool operator==(const base_iterator<W> &rhs) const {
+			return e == rhs.e && self == rhs.self;
+		}
+		template<class W>
+		bool operator!=(const base_iterator<W> &rhs) const {
+			return !(*this == rhs);
+		}
+	};
+	typedef base_iterator<T> iterator;
+	typedef base_iterator<const T> const_iterator;
+
+	/**
+	 * a cache holding elements of total weight up to budget.
+	 */
+	explicit lru_map(size_t budget): head(0), tail(0), total(0), cap(budget) {}
+	lru_map(const lru_map &o): head(0), tail(0), total(0), cap(o.cap), evicted(o.evicted) {
+		copy(o);
+	}
+	lru_map& operator=(const lru_map &o) {
+		if (this == &o) {
+			return *this;
+		}
+		clear();
+		cap = o.cap;
+		evicted = o.evicted;
+		copy(o);
+		return *this;
+	}
+	/**
+	 * called as f(key, value) for every element evicted to stay within the
+	 *   budget, right before it is destroyed: the value may be moved out.
+	 *   erase and clear are not evictions and do not call it.
+	 */
+	void on_evict(std::function<void(const Key&, T&)> f) {
+		evicted = f;
+	}
+	/**
+	 * change the budget, evicting what no longer fits.
+	 */
+	void set_budget(size_t budget) {
+		cap = budget;
+		shrink();
+	}
+	size_t budget() const {
+		return cap;
+	}
+	/**
+	 * the total weight of the elements.
+	 */
+	size_t weight() const {
+		return total;
+	}
+	/**
+	 * access specified element with bounds checking, and make it the most
+	 *   recently used.
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	T& at(const Key &key) {
+		typename index::iterator it = idx.find(key);
+		if (it == idx.end())
+			throw index_out_of_bound();
+		touch(&*it);
+		return it->second.val;
+	}
+	/**
+	 * the element with key without making it more recently used,
+	 *   end() if there is none.
+	 */
+	const_iterator peek(const Key &key) const {
+		typename index::const_iterator it = idx.find(key);
+		if (it == idx.cend()) return cend();
+		return const_iterator(this, const_cast<elem*>(&*it));
+	}
+	/**
+	 * Finds an element with key equivalent to key and makes it the most
+	 *   recently used. If no such element is found, end() is returned.
+	 */
+	iterator find(const Key &key) {
+		typename index::iterator it = idx.find(key);
+		if (it == idx.end()) return end();
+		touch(&*it);
+		return iterator(this, &*it);
+	}
+	size_t count(const Key &key) const {
+		return idx.count(key);
+	}
+	iterator begin() {
+		return iterator(this, head);
+	}
+	const_iterator cbegin() const {
+		return const_iterator(this, head);
+	}
+	iterator end() {
+		return iterator(this, 0);
+	}
+	const_iterator cend() const {
+		return const_iterator(this, 0);
+	}
+	bool empty() const {
+		return idx.empty();
+	}
+	size_t size() const {
+		return idx.size();
+	}
+	/**
+	 * clears the contents, nothing is passed to the eviction callback.
+	 */
+	void clear() {
+		idx.clear();
+		head = tail = 0;
+		total = 0;
+	}
+	/**
+	 * insert an element as the most recently used, then evict down to the
+	 *   budget. an element heavier than the whole budget is evicted at once,
+	 *   on its own: the other elements stay.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 * a failed insert still makes the element there the most recently used.
+	 */
+	pair<iterator, bool> insert(const value_type &value) {
+		pair<typename index::iterator, bool> r = idx.try_emplace(value.first, value.second);
+		elem *e = &*r.first;
+		if (!r.second) {
+			touch(e);
+			return pair<iterator, bool>(iterator(this, e), false);
+		}
+		return pair<iterator, bool>(admit(e), true);
+	}
+	/**
+	 * assign obj to the value of key, or insert it if key is missing.
+	 *   either way it becomes the most recently used, and the weight is
+	 *   taken again before evicting down to the budget.
+	 *   the second of the result is true for an insertion.
+	 */
+	template<class M>
+	pair<iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+		pair<typename index::iterator, bool> r = idx.try_emplace(key, std::forward<M>(obj));
+		elem *e = &*r.first;
+		if (r.second)
+			return pair<iterator, bool>(admit(e), true);
+		e->second.val = std::forward<M>(obj);
+		detach(e);
+		total -= e->second.w;
+		return pair<iterator, bool>(admit(e), false);
+	}
+	/**
+	 * erase the element with key, return the number of elements erased (0 or 1).
+	 */
+	size_t erase(const Key &key) {
+		typename index::iterator it = idx.find(key);
+		if (it == idx.end()) return 0;
+		elem *e = &*it;
+		detach(e);
+		total -= e->second.w;
+		idx.erase(it);
+		return 1;
+	}
+	/**
+	 * erase the element at pos.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(iterator pos) {
+		if (pos.self != this || !pos.e) throw invalid_iterator();
+		erase(pos.e->first);
+	}
+
+private:
+	index idx;
+	elem *head, *tail; // most and least recently used
+	size_t total, cap;
+	Weigher weigh;
+	std::function<void(const Key&, T&)> evicted;
+
+	void detach(elem *e) {
+		entry &x = e->second;
+		if (x.newer) x.newer->second.older = x.older;
+		else head = x.older;
+		if (x.older) x.older->second.newer = x.newer;
+		else tail = x.newer;
+		x.newer = x.older = 0;
+	}
+	void push_front(elem *e) {
+		e->second.older = head;
+		if (head) head->second.newer = e;
+		else tail = e;
+		head = e;
+	}
+	void touch(elem *e) {
+		if (head == e) return;
+		detach(e);
+		push_front(e);
+	}
+	/*
+	   e is new or just changed, out of the list: weigh it, put it in front
+	   and make room. end() if it does not fit even alone, then it is the
+	   only one evicted
+	 */
+	iterator admit(elem *e) {
+		size_t w = weigh(e->first, e->second.val);
+		if (w > cap) {
+			if (evicted) evicted(e->first, e->second.val);
+			idx.erase(e->first);
+			return end();
+		}
+		e->second.w = w;
+		total += w;
+		push_front(e);
+		shrink();
+		return iterator(this, e);
+	}
+	void shrink() {
+		while (total > cap && tail) {
+			elem *e = tail;
+			detach(e);
+			total -= e->second.w;
+			if (evicted) evicted(e->first, e->second.val);
+			idx.erase(e->first);
+		}
+	}
+	/*
+	   oldest first, so the order comes out the same
+	 */
+	void copy(const lru_map &o) {
+		for (elem *e = o.tail; e; e = e->second.newer) {
+			elem *x = &*idx.try_emplace(e->first, e->second.val).first;
+			x->second.w = e->second.w;
+			total += x->second.w;
+			push_front(x);
+		}
+	}
+};
+
+}
+
+#endif
@@ -7,17 +7,17 @@
 // only for std::less<T>
 #include <functional>
 #include <cstddef>
+#include <type_traits>
+#include <atomic>
+#include <cstring>
 #include "utility.hpp"
 #include "exceptions.hpp"
 
-inline int rnd() {
-	static unsigned seed = 6791654;
-	seed = seed * 998244353 + 21474;
-	return seed & ((1u << 31) - 1);
-}
-
 namespace sjtu {
 
+class epoch;
+template<class Key, class T, class Compare> class static_map;
+
 template<class T>
 inline T max(const T &x, const T &y) {
 	return x > y ? x : y;
@@ -29,11 +29,261 @@ inline void swap(T &x, T &y) {
 	y = z;
 }
 
+/**
+ * default Augment of map: nothing is kept but the subtree size.
+ *
+ * an Augment is a monoid over the elements, kept for every subtree:
+ *   typedef ... value_type;
+ *   static value_type identity();
+ *   static value_type of(const pair<const Key, T> &element);
+ *   static value_type combine(const value_type &l, const value_type &r);
+ * combine must be associative, it is always applied in key order.
+ */
+struct no_augment {};
+
+template<class Augment>
+struct augment_field {
+	typedef typename Augment::value_type agg_type;
+	static const bool kept = true;
+	agg_type agg;
+
+	static agg_type get(const augment_field *o) {
+		return o ? o->agg : Augment::identity();
+	}
+	template<class V>
+	void pull(const augment_field *l, const augment_field *r, const V &v) {
+		agg = Augment::combine(Augment::combine(get(l), Augment::of(v)), get(r));
+	}
+};
+template<>
+struct augment_field<no_augment> {
+	static const bool kept = false;
+	template<class V>
+	void pull(const augment_field *, const augment_field *, const V &) {}
+};
+
+/**
+ * balancing schemes of map.
+ * every node has one int r for the scheme: a priority for the treap,
+ *   the height for AVL, the colour for red-black.
+ * a scheme provides
+ *   init(m, x)      set r of a new node
+ *   attached(m, x)  x was just hung under a leaf, rebalance
+ *   detach(m, x)    take x out of the tree (the thread is done by map)
+ *   build(m, a, n)  make a tree of the n nodes in a, in key order
+ * and joinable, whether split/join (and everything built on them) work.
+ */
+struct treap_balance {
+	static const bool joinable = true;
+
+	template<class Map>
+	static void init(Map &m, typename Map::node *x) {
+		x->r = m.priority(x->val->first);
+	}
+	template<class Map>
+	static void attached(Map &m, typename Map::node *x) {
+		while (x->fa && x->fa->r < x->r)
+			m.rotate_up(x);
+		m.refresh_up(x->fa);
+	}
+	template<class Map>
+	static void detach(Map &m, typename Map::node *x) {
+		while (x->lc && x->rc)
+			m.rotate_up(x->lc->r > x->rc->r ? x->lc : x->rc);
+		m.refresh_up(m.splice(x));
+	}
+	template<class Map>
+	static typename Map::node* build(Map &m, typename Map::node **a, int n) {
+		return m.spine_build(a, n);
+	}
+};
+
+/**
+ * AVL tree: r is the height of the subtree.
+ */
+struct avl_balance {
+	static const bool joinable = false;
+
+	template<class N>
+	static int height(N *o) {
+		return o ? o->r : 0;
+	}
+	template<class N>
+	static void fix(N *o) {
+		o->r = max(height(o->lc), height(o->rc)) + 1;
+	}
+	/*
+	   rebalance o, return the node now in its place
+	 */
+	template<class Map>
+	static typename Map::node* balance(Map &m, typename Map::node *o) {
+		int d = height(o->lc) - height(o->rc);
+		if (d > 1) {
+			if (height(o->lc->lc) < height(o->lc->rc)) {
+				m.rotate_up(o->lc->rc);
+				fix(o->lc->lc);
+			}
+			m.rotate_up(o->lc);
+		} else if (d < -1) {
+			if (height(o->rc->rc) < height(o->rc->lc)) {
+				m.rotate_up(o->rc->lc);
+				fix(o->rc->rc);
+			}
+			m.rotate_up(o->rc);
+		} else {
+			fix(o);
+			return o;
+		}
+		fix(o);
+		fix(o->fa);
+		return o->fa;
+	}
+	/*
+	   walk up from o until a subtree keeps its height
+	 */
+	template<class Map>
+	static void rebalance(Map &m, typename Map::node *o) {
+		while (o) {
+			int h = o->r;
+			o = balance(m, o);
+			if (o->r == h) break;
+			o = o->fa;
+		}
+	}
+	template<class Map>
+	static void init(Map &, typename Map::node *x) {
+		x->r = 1;
+	}
+	template<class Map>
+	static void attached(Map &m, typename Map::node *x) {
+		m.refresh_up(x->fa);
+		rebalance(m, x->fa);
+	}
+	template<class Map>
+	static void detach(Map &m, typename Map::node *x) {
+		if (x->lc && x->rc)
+			m.exchange(x);
+		typename Map::node *f = m.splice(x);
+		m.refresh_up(f);
+		rebalance(m, f);
+	}
+	template<class Map>
+	static typename Map::node* build(Map &m, typename Map::node **a, int n) {
+		struct mark {
+			void operator()(typename Map::node *o, int) const {
+				fix(o);
+			}
+		};
+		return m.balanced(a, 0, n, 0, mark());
+	}
+};
+
+/**
+ * red-black tree: r is the colour.
+ * cheaper updates than AVL (at most three rotations per update),
+ *   a little deeper in exchange.
+ */
+struct red_black_balance {
+	static const bool joinable = false;
+	enum { black = 0, red = 1 };
+
+	template<class N>
+	static bool is_red(N *o) {
+		return o && o->r == red;
+	}
+	template<class Map>
+	static void init(Map &, typename Map::node *x) {
+		x->r = red;
+	}
+	template<class Map>
+	static void attached(Map &m, typename Map::node *x) {
+		typedef typename Map::node node;
+		m.refresh_up(x->fa);
+		while (is_red(x->fa)) {
+			node *p = x->fa, *g = p->fa;
+			node *u = g->lc == p ? g->rc : g->lc;
+			if (is_red(u)) {
+				p->r = u->r = black;
+				g->r = red;
+				x = g;
+				continue;
+			}
+			if ((g->lc == p) != (p->lc == x)) {
+				m.rotate_up(x);
+				x = p;
+				p = x->fa;
+			}
+			p->r = black;
+			g->r = red;
+			m.rotate_up(p);
+			break;
+		}
+		m.root->r = black;
+	}
+	template<class Map>
+	static void detach(Map &m, typename Map::node *x) {
+		typedef typename Map::node node;
+		if (x->lc && x->rc)
+			m.exchange(x);
+		node *c = x->lc ? x->lc : x->rc;
+		node *f = m.splice(x);
+		m.refresh_up(f);
+		if (x->r == red) return;
+		while (c != m.root && !is_red(c)) {
+			bool left = f->lc == c;
+			node *w = left ? f->rc : f->lc;
+			if (is_red(w)) {
+				w->r = black;
+				f->r = red;
+				m.rotate_up(w);
+				w = left ? f->rc : f->lc;
+			}
+			node *near = left ? w->lc : w->rc, *far = left ? w->rc : w->lc;
+			if (!is_red(near) && !is_red(far)) {
+				w->r = red;
+				c = f;
+				f = c->fa;
+				continue;
+			}
+			if (!is_red(far)) {
+				near->r = black;
+				w->r = red;
+				m.rotate_up(near);
+				w = near;
+				far = left ? w->rc : w->lc;
+			}
+			w->r = f->r;
+			f->r = black;
+			far->r = black;
+			m.rotate_up(w);
+			c = m.root;
+		}
+		if (c) c->r = black;
+	}
+	template<class Map>
+	static typename Map::node* build(Map &m, typename Map::node **a, int n) {
+		int d = 0;
+		while ((2 << d) <= n + 1) ++d;
+		struct mark {
+			int d;
+			void operator()(typename Map::node *o, int depth) const {
+				o->r = depth == d ? red : black;
+			}
+		} mk;
+		mk.d = d;
+		return m.balanced(a, 0, n, 0, mk);
+	}
+};
+
 template<
 	class Key,
 	class T,
-	class Compare = std::less<Key>
+	class Compare = std::less<Key>,
+	class BalancePolicy = treap_balance,
+	class Augment = no_augment,
+	bool Multi = false
 > class map {
+	friend BalancePolicy;
 public:
 	/**
 	 * the internal type of data.
@@ -42,17 +292,22 @@ public:
 	 */
 	typedef pair<const Key, T> value_type;
 
-	struct node
+	struct node : augment_field<Augment>
 	{
 		value_type *val;
-		node *lc, *rc, *pre, *nxt;
-		int r, sz;
+		node *lc, *rc, *pre, *nxt, *fa;
+		int r, sz; // r belongs to BalancePolicy
 
-		node(): val(0), lc(0), rc(0), pre(0), nxt(0), sz(0) {}
-		node(const value_type &_val): lc(0), rc(0), pre(0), nxt(0), r(rnd()), sz(1) {
-			val = new value_type(_val);
+		node(): val(0), lc(0), rc(0), pre(0), nxt(0), fa(0), sz(0) {}
+		/*
+		   the element is built in place from args
+		 */
+		template<class... Args>
+		explicit node(int r, Args&&... args): lc(0), rc(0), pre(0), nxt(0), fa(0), r(r), sz(1) {
+			val = new value_type(std::forward<Args>(args)...);
+			this->pull(0, 0, *val);
 		}
-		node(const node &o): lc(o.lc), rc(o.rc), pre(o.pre), nxt(o.nxt), r(o.r), sz(o.sz) {
+		node(const node &o): lc(o.lc), rc(o.rc), pre(o.pre), nxt(o.nxt), fa(o.fa), r(o.r), sz(o.sz) {
 			val = new value_type(*o.val);
 		}
 		~node() {
@@ -61,8 +316,15 @@ public:
 		static int get_size(node *o) {
 			return o ? o->sz : 0;
 		}
+		/*
+		   called whenever the children change,
+		   so it also keeps the parent pointers of the children
+		 */
 		void update() {
 			sz = get_size(lc) + get_size(rc) + 1;
+			this->pull(lc, rc, *val);
+			if (lc) lc->fa = this;
+			if (rc) rc->fa = this;
 		}
 	};
 
@@ -96,9 +358,36 @@ public:
 		}
 		/**
 		 * return a new iterator which pointer n-next elements
-		 *   even if there are not enough elements, just return the answer.
 		 * as well as operator-
+		 *
+		 * the jump goes through the subtree sizes: O(log n), not n steps.
+		 * moving before begin() or past end() throws invalid_iterator.
+		 */
+		base_iterator operator+(int n) const {
+			if (!self) throw invalid_iterator();
+			int k = self->position(data) + n;
+			if (k < 0 || k > (int)self->size()) throw invalid_iterator();
+			node *t = self->get_kth(self->root, k + 1);
+			return base_iterator(self, t ? t : self->ed);
+		}
+		base_iterator operator-(int n) const {
+			return *this + (-n);
+		}
+		base_iterator& operator+=(int n) {
+			*this = *this + n;
+			return *this;
+		}
+		base_iterator& operator-=(int n) {
+			*this = *this + (-n);
+			return *this;
+		}
+		/**
+		 * distance between two iterators of the same map.
 		 */
+		int operator-(const base_iterator &rhs) const {
+			if (!self || self != rhs.self) throw invalid_iterator();
+			return self->position(data) - self->position(rhs.data);
+		}
 		/**
 		 * iter++
 		 */
@@ -155,22 +444,101 @@ public:
 	};
 	typedef base_iterator<value_type&, value_type*> iterator;
 	typedef base_iterator<const value_type&, const value_type*> const_iterator;
+	/**
+	 * a pair of iterators [first, last) that can be used in range-for.
+	 */
+	template<class It>
+	class base_range {
+	private:
+		It first, last;
+	public:
+		base_range(const It &first, const It &last): first(first), last(last) {}
+		It begin() const {
+			return first;
+		}
+		It end() const {
+			return last;
+		}
+		bool empty() const {
+			return first == last;
+		}
+	};
+	typedef base_range<iterator> range_type;
+	typedef base_range<const_iterator> const_range_type;
+	/**
+	 * an element taken out of a map by extract(), together with its node.
+	 * insert() of any map of the same type takes it back without
+	 *   allocating or copying anything. the element is freed with the
+	 *   handle if it is never inserted again.
+	 * the key is read only, the mapped value can be changed.
+	 */
+	class node_type {
+		friend class map;
+	private:
+		node *x;
+		void (*reclaim)(node*); // that of the map it came from
+		node_type(node *x, void (*reclaim)(node*)): x(x), reclaim(reclaim) {}
+
+	public:
+		node_type(): x(0), reclaim(0) {}
+		node_type(node_type &&o): x(o.x), reclaim(o.reclaim) {
+			o.x = 0;
+		}
+		node_type& operator=(node_type &&o) {
+			if (this == &o) return *this;
+			dispose(x, reclaim);
+			x = o.x;
+			reclaim = o.reclaim;
+			o.x = 0;
+			return *this;
+		}
+		~node_type() {
+			dispose(x, reclaim);
+		}
+		bool empty() const {
+			return !x;
+		}
+		explicit operator bool() const {
+			return x;
+		}
+		/**
+		 * throw container_is_empty if the handle is empty.
+		 */
+		const Key& key() const {
+			if (!x) throw container_is_empty();
+			return x->val->first;
+		}
+		T& mapped() const {
+			if (!x) throw container_is_empty();
+			return x->val->second;
+		}
+	};
+	/**
+	 * the result of insert(node_type&&): where the key is, whether the node
+	 *   went in, and the node back if it did not.
+	 */
+	struct insert_return_type {
+		iterator position;
+		bool inserted;
+		node_type node;
+	};
 	/**
 	 * two constructors
 	 */
-	map(): root(0) {
+	map(): root(0), state(scramble((size_t)this)), key_hash(0), seq(0), writing(0), reclaim(0) {
 		st = ed = new node();
 	}
-	map(const map &o): root(0) {
-		if (!o.root) {
-			st = ed = new node();
-		} else {
-			ed = new node();
-			copy(root, o.root);
-			node *tmp = 0;
-			relink(root, tmp);
-			link(tmp, ed);
-		}
+	map(const map &o): root(0), state(o.state), key_hash(o.key_hash), seq(0), writing(0), reclaim(0) {
+		st = ed = new node();
+		copy(o);
+	}
+	/**
+	 * build from a range sorted by key, see build_sorted().
+	 */
+	template<class InputIterator>
+	map(sorted_unique_t, InputIterator first, InputIterator last): root(0), state(scramble((size_t)this)), key_hash(0), seq(0), writing(0), reclaim(0) {
+		st = ed = new node();
+		build_sorted(first, last);
 	}
 	/**
 	 * assignment operator
@@ -179,13 +547,11 @@ public:
 		if (this == &o) {
 			return *this;
 		}
+		write_scope w(*this);
 		clear();
-		if (o.root) {
-			copy(root, o.root);
-			node *tmp = 0;
-			relink(root, tmp);
-			link(tmp, ed);
-		}
+		state = o.state;
+		key_hash = o.key_hash;
+		copy(o);
 		return *this;
 	}
 	/**
@@ -201,12 +567,14 @@ public:
 	 * If no such element exists, an exception of type `index_out_of_bound'
 	 */
 	T& at(const Key &key) {
+		static_assert(!Multi, "a multimap has no single value per key");
 		node *o = find(root, key);
 		if (!o)
 			throw index_out_of_bound();
 		return o->val->second;
 	}
 	const T& at(const Key &key) const {
+		static_assert(!Multi, "a multimap has no single value per key");
 		node *o = find(root, key);
 		if (!o)
 			throw index_out_of_bound();
@@ -218,8 +586,10 @@ public:
 	 *   performing an insertion if such key does not already exist.
 	 */
 	T & operator[](const Key &key) {
-		node *o = insert(value_type(key, T())).first.data;
-		return o->val->second;
+		return try_emplace(key).first->second;
+	}
+	T & operator[](Key &&key) {
+		return try_emplace(std::move(key)).first->second;
 	}
 	/**
 	 * behave like at() throw index_out_of_bound if such key does not exist.
@@ -263,11 +633,128 @@ public:
 	 * clears the contents
 	 */
 	void clear() {
-		make_empty(root);
+		write_scope w(*this);
+		make_empty();
 		root = 0;
 		ed->pre = 0;
 		st = ed;
 	}
+	/**
+	 * replace the contents with the elements of [first, last).
+	 * while the keys are strictly increasing (or only not decreasing, in a
+	 *   multimap) the tree and its thread are built in O(n) by
+	 *   BalancePolicy::build, without any search or rotation.
+	 * the first element out of order (or with a repeated key) and everything
+	 *   after it fall back to ordinary insert, so unsorted input still gives
+	 *   the right map, only slower.
+	 */
+	template<class InputIterator>
+	void build_sorted(InputIterator first, InputIterator last) {
+		write_scope w(*this);
+		clear();
+		buffer<node*> a;
+		node *tmp = 0;
+		for (; first != last; ++first) {
+			if (tmp && (Multi ? cmp((*first).first, tmp->val->first) : !cmp(tmp->val->first, (*first).first)))
+				break;
+			node *x = new_node(*first);
+			if (!tmp) st = x;
+			link(tmp, x); tmp = x;
+			a.push(x);
+		}
+		link(tmp, ed);
+		set_root(BalancePolicy::build(*this, &a[0], a.size()));
+		for (; first != last; ++first)
+			insert_node(*first);
+	}
+	/**
+	 * an immutable copy laid out for lookups, built in O(n), see static_map.
+	 * this needs static_map.hpp included, a map that is never frozen does
+	 *   not pull it in.
+	 */
+	template<class S = static_map<Key, T, Compare> >
+	S freeze() const {
+		static_assert(!Multi, "static_map keeps unique keys");
+		return S(*this);
+	}
+	/**
+	 * optimistic reads, for maps that many threads read and few write.
+	 * while on, every change bumps a sequence counter (odd while it runs)
+	 *   and erased nodes are freed through epoch::retire instead of at once.
+	 * optimistic_count, optimistic_find and optimistic_at may then run in any
+	 *   thread beside a writer, with no lock and no write to shared memory:
+	 *   they descend, and start over if the counter moved meanwhile.
+	 * writers still exclude each other (a mutex of their own), and values
+	 *   may only change through the map (insert_or_assign), not through
+	 *   references into it. switch it while no other thread uses the map.
+	 * these need epoch.hpp included, a map that never turns them on does
+	 *   not pull the epoch machinery in.
+	 */
+	template<class E = epoch>
+	void optimistic_reads(bool on) {
+		reclaim = on ? &retire<E> : 0;
+	}
+	template<class E = epoch>
+	size_t optimistic_count(const Key &key) const {
+		static_assert(!Multi, "a multimap has no single value per key");
+		typename E::guard g;
+		for (;;) {
+			unsigned s = read_begin();
+			node *o;
+			if (descend(key, s, o) && read_end(s))
+				return size_t(o ? 1 : 0);
+		}
+	}
+	/**
+	 * copy the value of key to out, false if key is missing.
+	 *   T must be trivially copyable: a copy torn by a writer is thrown away.
+	 */
+	template<class E = epoch>
+	bool optimistic_find(const Key &key, T &out) const {
+		static_assert(std::is_trivially_copyable<T>::value, "optimistic reads copy T byte by byte");
+		static_assert(!Multi, "a multimap has no single value per key");
+		return optimistic_copy<E>(key, &out);
+	}
+	/**
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	template<class E = epoch>
+	T optimistic_at(const Key &key) const {
+		static_assert(std::is_trivially_copyable<T>::value, "optimistic reads copy T byte by byte");
+		static_assert(!Multi, "a multimap has no single value per key");
+		alignas(T) unsigned char buf[sizeof(T)];
+		if (!optimistic_copy<E>(key, buf))
+			throw index_out_of_bound();
+		return *reinterpret_cast<T*>(buf);
+	}
+	/**
+	 * every map draws treap priorities from its own generator,
+	 *   seeded from its address unless seed() is called.
+	 * seeding makes the same sequence of operations give the same tree.
+	 * it also switches back from hash_priorities().
+	 */
+	void seed(unsigned s) {
+		state = s ? s : 1;
+		key_hash = 0;
+	}
+	/**
+	 * take the priority of each element from Hash()(key) instead, so that
+	 *   the shape of the tree only depends on the set of keys and not on
+	 *   the order they came in. the current elements are rebuilt in O(n).
+	 */
+	template<class Hash>
+	void hash_priorities() {
+		static_assert(BalancePolicy::joinable, "priorities are only used by treap_balance");
+		key_hash = &hash_key<Hash>;
+		write_scope w(*this);
+		buffer<node*> stk;
+		for (node *p = st; p != ed; p = p->nxt) {
+			p->r = priority(p->val->first);
+			p->lc = p->rc = 0;
+			spine_push(stk, p);
+		}
+		set_root(spine_finish(stk));
+	}
 	/**
 	 * insert an element.
 	 * return a pair, the first of the pair is
@@ -275,13 +762,106 @@ public:
 	 *   the second one is true if insert successfully, or false.
 	 */
 	pair<iterator, bool> insert(const value_type &value) {
-		auto res = insert(root, value);
-		if (res.second) {
-			if (root->sz == 1) {
-				st = res.first;
-				link(st, ed);
-			}
+		auto res = insert_node(value);
+		return pair<iterator, bool>(iterator(this, res.first), res.second);
+	}
+	pair<iterator, bool> insert(value_type &&value) {
+		node *f, *l, *r, **p = slot_for(value.first, f, l, r);
+		if (!p) return pair<iterator, bool>(iterator(this, f), false);
+		node *x = new_node(std::move(value));
+		attach(p, x, f, l, r);
+		return pair<iterator, bool>(iterator(this, x), true);
+	}
+	/**
+	 * build the element from args in its node. the node is made before
+	 *   the search, since the key is only known then, and freed again if
+	 *   the key is already there.
+	 */
+	template<class... Args>
+	pair<iterator, bool> emplace(Args&&... args) {
+		node *x = new_node(std::forward<Args>(args)...);
+		node *f, *l, *r, **p = slot_for(x->val->first, f, l, r);
+		if (!p) {
+			delete x;
+			return pair<iterator, bool>(iterator(this, f), false);
 		}
+		attach(p, x, f, l, r);
+		return pair<iterator, bool>(iterator(this, x), true);
+	}
+	/**
+	 * if key is missing, insert it with the value T(args...).
+	 *   nothing is built, copied or moved when key is already in the map.
+	 */
+	template<class... Args>
+	pair<iterator, bool> try_emplace(const Key &key, Args&&... args) {
+		static_assert(!Multi, "a multimap has no single value per key");
+		node *f, *l, *r, **p = slot_for(key, f, l, r);
+		if (!p) return pair<iterator, bool>(iterator(this, f), false);
+		node *x = new_node(key, T(std::forward<Args>(args)...));
+		attach(p, x, f, l, r);
+		return pair<iterator, bool>(iterator(this, x), true);
+	}
+	template<class... Args>
+	pair<iterator, bool> try_emplace(Key &&key, Args&&... args) {
+		static_assert(!Multi, "a multimap has no single value per key");
+		node *f, *l, *r, **p = slot_for(key, f, l, r);
+		if (!p) return pair<iterator, bool>(iterator(this, f), false);
+		node *x = new_node(std::move(key), T(std::forward<Args>(args)...));
+		attach(p, x, f, l, r);
+		return pair<iterator, bool>(iterator(this, x), true);
+	}
+	/**
+	 * assign obj to the value of key, or insert it if key is missing.
+	 *   the second of the result is true for an insertion.
+	 */
+	template<class M>
+	pair<iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+		static_assert(!Multi, "a multimap has no single value per key");
+		node *f, *l, *r, **p = slot_for(key, f, l, r);
+		if (!p) return pair<iterator, bool>(iterator(this, assign(f, std::forward<M>(obj))), false);
+		node *x = new_node(key, std::forward<M>(obj));
+		attach(p, x, f, l, r);
+		return pair<iterator, bool>(iterator(this, x), true);
+	}
+	template<class M>
+	pair<iterator, bool> insert_or_assign(Key &&key, M &&obj) {
+		static_assert(!Multi, "a multimap has no single value per key");
+		node *f, *l, *r, **p = slot_for(key, f, l, r);
+		if (!p) return pair<iterator, bool>(iterator(this, assign(f, std::forward<M>(obj))), false);
+		node *x = new_node(std::move(key), std::forward<M>(obj));
+		attach(p, x, f, l, r);
+		return pair<iterator, bool>(iterator(this, x), true);
+	}
+	/**
+	 * insert with a hint.
+	 * if the key belongs right before or right after hint (checked against
+	 *   the neighbours on the thread), the node is attached there directly
+	 *   and rebalanced bottom-up through the parent pointers,
+	 *   with no further key comparison.
+	 * otherwise it is the same as insert(value).
+	 * return the iterator to the new element (or the element that prevented the insertion).
+	 */
+	iterator insert(const_iterator hint, const value_type &value) {
+		if (hint.self != this) throw invalid_iterator();
+		return iterator(this, insert_near(hint.data, value).first);
+	}
+	/**
+	 * the element is built from args in its node, which is freed again if
+	 *   the key is already there.
+	 */
+	template<class... Args>
+	iterator emplace_hint(const_iterator hint, Args&&... args) {
+		if (hint.self != this) throw invalid_iterator();
+		node *x = new_node(std::forward<Args>(args)...);
+		return iterator(this, insert_near(hint.data, x).first);
+	}
+	/**
+	 * append an element whose key is greater than every key in the map,
+	 *   using one key comparison against the current maximum.
+	 * a key that is not a new maximum is inserted the normal way.
+	 */
+	pair<iterator, bool> push_back_max(const value_type &value) {
+		auto res = insert_near(ed, value);
 		return pair<iterator, bool>(iterator(this, res.first), res.second);
 	}
 	/**
@@ -292,17 +872,98 @@ public:
 	void erase(iterator pos) {
 		if (pos.self != this) throw invalid_iterator();
 		if (!pos.data || !pos.data->val) throw invalid_iterator(); // end()
-		remove(root, pos.data->val->first);
+		remove(pos.data);
+	}
+	/**
+	 * unlink the element at pos and hand it over with its node,
+	 *   nothing is freed or copied. iterators to other elements stay valid.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	node_type extract(iterator pos) {
+		if (pos.self != this) throw invalid_iterator();
+		if (!pos.data || !pos.data->val) throw invalid_iterator(); // end()
+		unlink(pos.data);
+		return node_type(pos.data, reclaim);
+	}
+	/**
+	 * the same for the element with key, an empty handle if there is none.
+	 */
+	node_type extract(const Key &key) {
+		node *o = find(root, key);
+		if (!o) return node_type();
+		unlink(o);
+		return node_type(o, reclaim);
+	}
+	/**
+	 * insert the node held by nh, taking it over if its key is not in the map
+	 *   yet. otherwise nh is moved to the result unchanged.
+	 */
+	insert_return_type insert(node_type &&nh) {
+		insert_return_type res;
+		res.inserted = false;
+		if (!nh.x) {
+			res.position = end();
+			return res;
+		}
+		node *f, *l, *r, **p = slot_for(nh.x->val->first, f, l, r);
+		if (!p) {
+			res.position = iterator(this, f);
+			res.node = std::move(nh);
+			return res;
+		}
+		node *x = nh.x;
+		nh.x = 0;
+		adopt(x);
+		attach(p, x, f, l, r);
+		res.position = iterator(this, x);
+		res.inserted = true;
+		return res;
+	}
+	/**
+	 * erase the elements in [first, last), return last.
+	 * with a joinable BalancePolicy the range is cut out with two splits by
+	 *   rank (so a multimap can cut inside a run of equal keys) and the tree
+	 *   is joined again, then the nodes are freed along the thread:
+	 *   O(log n + k). otherwise they are erased one by one.
+	 */
+	iterator erase(iterator first, iterator last) {
+		if (first.self != this || last.self != this) throw invalid_iterator();
+		if (first == last) return last;
+		if (!first.data->val) throw invalid_iterator();
+		int a = position(first.data), b = position(last.data);
+		if (b < a) throw invalid_iterator();
+		if (!BalancePolicy::joinable) {
+			while (first != last)
+				remove((first++).data);
+			return last;
+		}
+		write_scope w(*this);
+		node *l, *m, *r;
+		split_rank(root, a, l, m);
+		split_rank(m, b - a, m, r);
+		set_root(join(l, r));
+		if (st == first.data)
+			st = last.data;
+		link(first.data->pre, last.data);
+		node *x = first.data;
+		for (int i = m->sz; i; --i) {
+			node *y = x->nxt;
+			dispose(x);
+			x = y;
+		}
+		return last;
 	}
 	/**
 	 * Returns the number of elements with key 
 	 *   that compares equivalent to the specified argument,
 	 *   which is either 1 or 0 
 	 *     since this container does not allow duplicates.
+	 *   in a multimap it is the difference of two ranks, O(log n).
 	 * The default method of check the equivalence is !(a < b || b > a)
 	 */
 	size_t count(const Key &key) const {
-		return size_t(find(root, key) ? 1 : 0);
+		return count_of(key);
 	}
 	/**
 	 * Finds an element with key equivalent to key.
@@ -320,6 +981,43 @@ public:
 		if (!o) return cend();
 		return const_iterator(const_cast<map*>(this), o);
 	}
+	/**
+	 * find() for every key of [first, last), the iterators are written to out
+	 *   in the same order. returns out after the last one written.
+	 * the keys are taken in groups of batch that go down the tree side by
+	 *   side: each step of one descent prefetches what its next step reads,
+	 *   then the other descents of the group run while that load is in flight.
+	 *   on a tree much larger than the cache the misses of a group overlap
+	 *   instead of being paid one after another.
+	 */
+	template<class ForwardIterator, class OutputIterator>
+	OutputIterator find_many(ForwardIterator first, ForwardIterator last, OutputIterator out) {
+		const Key *k[batch];
+		node *hit[batch];
+		while (first != last) {
+			int g = 0;
+			for (; g < batch && first != last; ++g, ++first)
+				k[g] = &*first;
+			find_group(k, hit, g);
+			for (int i = 0; i < g; ++i)
+				*out++ = hit[i] ? iterator(this, hit[i]) : end();
+		}
+		return out;
+	}
+	template<class ForwardIterator, class OutputIterator>
+	OutputIterator find_many(ForwardIterator first, ForwardIterator last, OutputIterator out) const {
+		const Key *k[batch];
+		node *hit[batch];
+		while (first != last) {
+			int g = 0;
+			for (; g < batch && first != last; ++g, ++first)
+				k[g] = &*first;
+			find_group(k, hit, g);
+			for (int i = 0; i < g; ++i)
+				*out++ = hit[i] ? const_iterator(const_cast<map*>(this), hit[i]) : cend();
+		}
+		return out;
+	}
 	/*
 	   Find the element position at k-th if sorted
 	   If no such element is found, past-the-end (see end()) iterator is returned.
@@ -334,159 +1032,1213 @@ public:
 		if (!t) return cend();
 		return const_iterator(const_cast<map*>(this), t);
 	}
-
-private:
-	node *root, *st, *ed;
-	Compare cmp;
-
-	void link(node *l, node *r) {
-		if (l) l->nxt = r;
-		if (r) r->pre = l;
-	}
-	/*
-	   copy copy copy!!
+	/**
+	 * the element at position k (from 0), end() if k >= size().
 	 */
-	void copy(node *&o, const node *other) {
-		if (!other) return;
-		o = new node(*other->val);
-		copy(o->lc, other->lc);
-		copy(o->rc, other->rc);
-		o->update();
+	iterator nth(int k) {
+		node *t = get_kth(root, k + 1);
+		if (!t) return end();
+		return iterator(this, t);
 	}
-	/*
-	   clear all data
-	   behave like stl_tree.hpp
+	const_iterator nth(int k) const {
+		node *t = get_kth(root, k + 1);
+		if (!t) return cend();
+		return const_iterator(const_cast<map*>(this), t);
+	}
+	/**
+	 * the number of elements whose key is less than key,
+	 *   which is the position of key if it is in the map.
 	 */
-	void make_empty(node* o) {
-		node *p;
+	int index_of(const Key &key) const {
+		int k = 0;
+		node *o = root;
 		while (o) {
-			if (o->lc)
-				make_empty(o->lc);
-			p = o;
-			o = o->rc;
-			delete p;
+			if (cmp(o->val->first, key)) {
+				k += node::get_size(o->lc) + 1;
+				o = o->rc;
+			} else {
+				o = o->lc;
+			}
 		}
+		return k;
 	}
-	void relink(node *o, node *&tmp) {
-		if (o->lc) relink(o->lc, tmp);
-		if (!tmp) st = o;
-		link(tmp, o); tmp = o;
-		if (o->rc) relink(o->rc, tmp);
+	/**
+	 * the position of the element it points to, size() for end().
+	 */
+	int index_of(const_iterator it) const {
+		if (it.self != this) throw invalid_iterator();
+		return position(it.data);
 	}
-	/*
-	   return pointer to key
-	   if cannot find, return NULL
+	/**
+	 * the number of elements with lo <= key < hi, in O(log n).
 	 */
-	node* find(node *o, const Key &key) const {
-		while (o) {
-			if (cmp(key, o->val->first))
-				o = o->lc;
-			else if (cmp(o->val->first, key))
-				o = o->rc;
-			else 
-				break;
-		}
-		return o;
+	size_t count_range(const Key &lo, const Key &hi) const {
+		if (!cmp(lo, hi)) return 0;
+		return index_of(hi) - index_of(lo);
 	}
-	void LL(node *&o) { // left rotate
-		node *k = o->lc;
-		o->lc = k->rc;
-		k->rc = o;
-		o->update();
-		k->update();
-		o = k;
+	/**
+	 * Returns an iterator to the first element whose key is not less than key,
+	 *   or end() if there is no such element.
+	 */
+	iterator lower_bound(const Key &key) {
+		return iterator(this, lower_bound(root, key));
 	}
-	void RR(node *&o) { // right rotate
-		node *k = o->rc;
-		o->rc = k->lc;
-		k->lc = o;
-		o->update();
-		k->update();
-		o = k;
+	const_iterator lower_bound(const Key &key) const {
+		return const_iterator(const_cast<map*>(this), lower_bound(root, key));
 	}
-
-	node *get_kth(node *o, int k) const {
-		if (get_size(o) < k) return 0;
-		int s = get_size(o->lc);
-		if (k == s + 1)
-			return o;
-		else if (k <= s)
-			return get_kth(o->lc, k);
-		else
-			return get_kth(o->rc, k - s - 1);
-	}
-
-	pair<node*, bool> insert(node *&o, const value_type &value) {
-		node *i;
-		bool ok = true;
-		if (!o) {
-			o = new node(value);
-			return pair<node*, bool>(o, true);
-		} else if (cmp(value.first, o->val->first)) {
-			bool flag = o->lc == 0;
-			auto res = insert(o->lc, value);
-			if (res.second == false)
-				return res;
-			else
-				i = res.first;
-			if (flag) {
-				if (st == o)
-					st = o->lc;
-				link(o->pre, o->lc);
-				link(o->lc, o);
-			}
-			if (o->lc->r > o->r)
-				LL(o);
-		} else if (cmp(o->val->first, value.first)) {
-			bool flag = o->rc == 0;
-			auto res = insert(o->rc, value);
-			if (res.second == false)
-				return res;
-			else
-				i = res.first;
-			if (flag) {
-				link(o->rc, o->nxt);
-				link(o, o->rc);
-			}
-			if (o->rc->r > o->r)
-				RR(o);
-		} else {
-			i = o;
-			ok = false;
-		}
-		o->update();
-		return pair<node*, bool>(i, ok);
+	/**
+	 * Returns an iterator to the first element whose key is greater than key,
+	 *   or end() if there is no such element.
+	 */
+	iterator upper_bound(const Key &key) {
+		return iterator(this, upper_bound(root, key));
+	}
+	const_iterator upper_bound(const Key &key) const {
+		return const_iterator(const_cast<map*>(this), upper_bound(root, key));
+	}
+	/**
+	 * Returns [lower_bound(key), upper_bound(key)) with a single descent.
+	 */
+	pair<iterator, iterator> equal_range(const Key &key) {
+		node *l = lower_bound(root, key);
+		node *r = Multi ? upper_bound(root, key) : l != ed && !cmp(key, l->val->first) ? l->nxt : l;
+		return pair<iterator, iterator>(iterator(this, l), iterator(this, r));
+	}
+	pair<const_iterator, const_iterator> equal_range(const Key &key) const {
+		node *l = lower_bound(root, key);
+		node *r = Multi ? upper_bound(root, key) : l != ed && !cmp(key, l->val->first) ? l->nxt : l;
+		map *self = const_cast<map*>(this);
+		return pair<const_iterator, const_iterator>(const_iterator(self, l), const_iterator(self, r));
+	}
+	/**
+	 * with a transparent Compare (one that defines is_transparent, like
+	 *   std::less<>), at, count, find, lower_bound, upper_bound,
+	 *   equal_range and erase also take any K that Compare can order
+	 *   against Key, e.g. a const char* or a string_view for string keys.
+	 *   the probe is compared as it is, no Key is built for it.
+	 */
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	T& at(const K &key) {
+		static_assert(!Multi, "a multimap has no single value per key");
+		node *o = find(root, key);
+		if (!o)
+			throw index_out_of_bound();
+		return o->val->second;
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const T& at(const K &key) const {
+		static_assert(!Multi, "a multimap has no single value per key");
+		node *o = find(root, key);
+		if (!o)
+			throw index_out_of_bound();
+		return o->val->second;
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	size_t count(const K &key) const {
+		return count_of(key);
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator find(const K &key) {
+		node *o = find(root, key);
+		if (!o) return end();
+		return iterator(this, o);
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator find(const K &key) const {
+		node *o = find(root, key);
+		if (!o) return cend();
+		return const_iterator(const_cast<map*>(this), o);
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator lower_bound(const K &key) {
+		return iterator(this, lower_bound(root, key));
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator lower_bound(const K &key) const {
+		return const_iterator(const_cast<map*>(this), lower_bound(root, key));
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator upper_bound(const K &key) {
+		return iterator(this, upper_bound(root, key));
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator upper_bound(const K &key) const {
+		return const_iterator(const_cast<map*>(this), upper_bound(root, key));
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	pair<iterator, iterator> equal_range(const K &key) {
+		node *l = lower_bound(root, key);
+		node *r = Multi ? upper_bound(root, key) : l != ed && !cmp(key, l->val->first) ? l->nxt : l;
+		return pair<iterator, iterator>(iterator(this, l), iterator(this, r));
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	pair<const_iterator, const_iterator> equal_range(const K &key) const {
+		node *l = lower_bound(root, key);
+		node *r = Multi ? upper_bound(root, key) : l != ed && !cmp(key, l->val->first) ? l->nxt : l;
+		map *self = const_cast<map*>(this);
+		return pair<const_iterator, const_iterator>(const_iterator(self, l), const_iterator(self, r));
+	}
+	/**
+	 * erase the element with key, return the number of elements erased (0 or 1).
+	 *   a multimap erases all of them.
+	 */
+	size_t erase(const Key &key) {
+		return erase_key(key);
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent,
+		class = typename std::enable_if<!std::is_convertible<const K&, const_iterator>::value>::type>
+	size_t erase(const K &key) {
+		return erase_key(key);
+	}
+	/**
+	 * all elements with lo <= key < hi, in order.
+	 * both ends are found by a descent, the elements in between are
+	 *   visited along the thread, so a scan costs O(log n + k).
+	 * an empty range is returned if hi < lo.
+	 */
+	range_type range(const Key &lo, const Key &hi) {
+		node *l = lower_bound(root, lo);
+		node *r = cmp(hi, lo) ? l : lower_bound(root, hi);
+		return range_type(iterator(this, l), iterator(this, r));
+	}
+	const_range_type range(const Key &lo, const Key &hi) const {
+		node *l = lower_bound(root, lo);
+		node *r = cmp(hi, lo) ? l : lower_bound(root, hi);
+		map *self = const_cast<map*>(this);
+		return const_range_type(const_iterator(self, l), const_iterator(self, r));
+	}
+	/**
+	 * the Augment value of all elements with lo <= key < hi, in O(log n).
+	 * only available when an Augment is given.
+	 */
+	template<class A = Augment>
+	typename A::value_type reduce(const Key &lo, const Key &hi) const {
+		typedef augment_field<A> field;
+		if (!cmp(lo, hi)) return A::identity();
+		node *o = root;
+		while (o) {
+			if (cmp(o->val->first, lo))
+				o = o->rc;
+			else if (!cmp(o->val->first, hi))
+				o = o->lc;
+			else
+				break;
+		}
+		if (!o) return A::identity();
+		typename A::value_type l = A::identity(), r = A::identity();
+		for (node *p = o->lc; p; ) {
+			if (cmp(p->val->first, lo)) {
+				p = p->rc;
+			} else {
+				l = A::combine(A::combine(A::of(*p->val), field::get(p->rc)), l);
+				p = p->lc;
+			}
+		}
+		for (node *p = o->rc; p; ) {
+			if (cmp(p->val->first, hi)) {
+				r = A::combine(r, A::combine(field::get(p->lc), A::of(*p->val)));
+				p = p->rc;
+			} else {
+				p = p->lc;
+			}
+		}
+		return A::combine(A::combine(l, A::of(*o->val)), r);
+	}
+	/**
+	 * the root of the tree, 0 when empty, for code that walks the tree
+	 *   itself (a search pruned on the Augment, a check of the shape).
+	 *   a node has lc, rc, fa, sz, r of the BalancePolicy and the Augment
+	 *   value, see augment_field::get. read only.
+	 */
+	const node* tree_root() const {
+		return root;
+	}
+	/**
+	 * the Augment value of the whole map.
+	 */
+	template<class A = Augment>
+	typename A::value_type reduce() const {
+		return augment_field<A>::get(root);
+	}
+	/**
+	 * recompute the aggregates above pos after its value was changed
+	 *   in place (through operator[], at() or the iterator).
+	 */
+	void refresh(iterator pos) {
+		if (pos.self != this || !pos.data || !pos.data->val) throw invalid_iterator();
+		for (node *o = pos.data; o; o = o->fa)
+			o->update();
+	}
+	/**
+	 * move every element whose key is not less than key into right.
+	 * the old contents of right are cleared.
+	 */
+	void split(const Key &key, map &right) {
+		static_assert(BalancePolicy::joinable, "split/join are only supported by treap_balance");
+		if (this == &right) throw runtime_error();
+		right.clear();
+		write_scope w(*this), wr(right);
+		node *l, *r;
+		split(root, key, l, r);
+		set_root(l);
+		right.set_root(r);
+		if (!r) return;
+		node *f = leftmost(r), *b = f->pre, *last = ed->pre;
+		right.st = f;
+		link(0, f);
+		link(last, right.ed);
+		link(b, ed);
+		if (!b) st = ed;
+	}
+	/**
+	 * append all elements of right, whose keys must all be greater than
+	 *   the keys of this map, otherwise runtime_error is thrown.
+	 * right becomes empty. costs O(log n), nothing is copied.
+	 */
+	void join(map &right) {
+		static_assert(BalancePolicy::joinable, "split/join are only supported by treap_balance");
+		if (this == &right) throw runtime_error();
+		if (!right.root) return;
+		if (root && (Multi ? cmp(right.st->val->first, ed->pre->val->first) : !cmp(ed->pre->val->first, right.st->val->first)))
+			throw runtime_error();
+		write_scope w(*this), wr(right);
+		set_root(join(root, right.root));
+		if (ed->pre)
+			link(ed->pre, right.st);
+		else
+			st = right.st;
+		link(right.ed->pre, ed);
+		right.root = 0;
+		right.ed->pre = 0;
+		right.st = right.ed;
+	}
+	/**
+	 * move the elements of other whose keys are not in this map into it.
+	 * elements with a key already present stay in other, like std::map::merge.
+	 * nodes are relinked, not copied.
+	 *
+	 * the set operations below all run in O(m log(n / m + 1)),
+	 *   where m <= n are the sizes of the two maps.
+	 */
+	void merge_from(map &other) {
+		static_assert(!Multi, "the set operations need unique keys");
+		static_assert(BalancePolicy::joinable, "split/join are only supported by treap_balance");
+		if (this == &other) return;
+		write_scope w(*this), wo(other);
+		buffer<node*> stk;
+		node *last = 0, *llast = 0;
+		set_root(merge(root, other.root, last, stk, llast));
+		finish(last);
+		other.set_root(spine_finish(stk));
+		other.st = other.root ? leftmost(other.root) : other.ed;
+		link(llast, other.ed);
+	}
+	/**
+	 * insert a copy of every element of other whose key is not in this map.
+	 */
+	void set_union(const map &other) {
+		static_assert(!Multi, "the set operations need unique keys");
+		static_assert(BalancePolicy::joinable, "split/join are only supported by treap_balance");
+		if (this == &other) return;
+		write_scope w(*this);
+		node *last = 0;
+		set_root(unite(root, other.root, last));
+		finish(last);
+	}
+	/**
+	 * keep only the elements whose key is also in other.
+	 */
+	void set_intersection(const map &other) {
+		static_assert(!Multi, "the set operations need unique keys");
+		static_assert(BalancePolicy::joinable, "split/join are only supported by treap_balance");
+		if (this == &other) return;
+		write_scope w(*this);
+		node *last = 0;
+		set_root(intersect(root, other.root, last));
+		finish(last);
+	}
+	/**
+	 * remove the elements whose key is in other.
+	 */
+	void set_difference(const map &other) {
+		static_assert(!Multi, "the set operations need unique keys");
+		static_assert(BalancePolicy::joinable, "split/join are only supported by treap_balance");
+		if (this == &other) {
+			clear();
+			return;
+		}
+		write_scope w(*this);
+		node *last = 0;
+		set_root(subtract(root, other.root, last));
+		finish(last);
 	}
 
-	void remove(node *&o, const Key &key) {
-		if (!o) throw runtime_error();
-		if (cmp(key, o->val->first)) {
-			remove(o->lc, key);
-		} else if (cmp(o->val->first, key)) {
-			remove(o->rc, key);
+private:
+	/*
+	   a growable stack used instead of recursion,
+	   the first few elements live inside the object
+	 */
+	template<class U>
+	class buffer {
+		U local[64];
+		U *a;
+		int n, cap;
+	public:
+		buffer(): a(local), n(0), cap(64) {}
+		~buffer() {
+			if (a != local) delete [] a;
+		}
+		int size() const {
+			return n;
+		}
+		U& operator[](int i) {
+			return a[i];
+		}
+		U& top() {
+			return a[n - 1];
+		}
+		U pop() {
+			return a[--n];
+		}
+		void push(const U &x) {
+			if (n == cap) {
+				U *b = new U[cap * 2];
+				for (int i = 0; i < n; ++i)
+					b[i] = a[i];
+				if (a != local) delete [] a;
+				a = b;
+				cap *= 2;
+			}
+			a[n++] = x;
+		}
+	};
+
+	node *root, *st, *ed;
+	Compare cmp;
+	unsigned state;
+	unsigned (*key_hash)(const Key &);
+	std::atomic<unsigned> seq; // odd while a change is running, for optimistic reads
+	int writing;
+	void (*reclaim)(node*); // 0 unless optimistic reads are on: free at once
+
+	/*
+	   brackets a change for optimistic readers, nested ones count once
+	 */
+	class write_scope {
+		map &m;
+	public:
+		explicit write_scope(map &m): m(m) {
+			if (m.reclaim && !m.writing++) {
+				m.seq.store(m.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+			}
+		}
+		~write_scope() {
+			if (m.reclaim && !--m.writing)
+				m.seq.store(m.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+	};
+	/*
+	   free x now, or once no optimistic reader can still be on it
+	 */
+	static void dispose(node *x, void (*reclaim)(node*)) {
+		if (!x) return;
+		if (!reclaim) {
+			delete x;
+			return;
+		}
+		reclaim(x);
+	}
+	void dispose(node *x) {
+		dispose(x, reclaim);
+	}
+	/*
+	   x is already out of the tree: E::retire stamps it with the epoch read
+	   now, after the unlink, not with the pin of this guard, so a reader that
+	   pinned just before the unlink still holds it back
+	 */
+	template<class E>
+	static void retire(node *x) {
+		typename E::guard g;
+		E::retire(x);
+	}
+	unsigned read_begin() const {
+		unsigned s;
+		while ((s = seq.load(std::memory_order_acquire)) & 1);
+		return s;
+	}
+	bool read_end(unsigned s) const {
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return seq.load(std::memory_order_relaxed) == s;
+	}
+	/*
+	   the descent of an optimistic read. a link is only followed once the
+	   version is seen unchanged after reading it, so the reader never steps
+	   into a node a running change has just hung in. false if a change got
+	   in the way
+	 */
+	bool descend(const Key &key, unsigned s, node *&o) const {
+		o = __atomic_load_n(&root, __ATOMIC_RELAXED);
+		while (o) {
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (seq.load(std::memory_order_relaxed) != s) return false;
+			int c = three_way(cmp, key, o->val->first);
+			if (!c) break;
+			o = __atomic_load_n(c < 0 ? &o->lc : &o->rc, __ATOMIC_RELAXED);
+		}
+		return true;
+	}
+	/*
+	   the bytes of the value of key into out, false if key is missing
+	 */
+	template<class E>
+	bool optimistic_copy(const Key &key, void *out) const {
+		typename E::guard g;
+		alignas(T) unsigned char buf[sizeof(T)];
+		for (;;) {
+			unsigned s = read_begin();
+			node *o;
+			if (!descend(key, s, o)) continue;
+			if (o) std::memcpy(buf, &o->val->second, sizeof(T));
+			if (!read_end(s)) continue;
+			if (!o) return false;
+			std::memcpy(out, buf, sizeof(T));
+			return true;
+		}
+	}
+
+	template<class Hash>
+	static unsigned hash_key(const Key &key) {
+		return scramble(Hash()(key));
+	}
+	/*
+	   xorshift on the map's own state, no shared seed between maps
+	 */
+	int priority(const Key &key) {
+		if (key_hash) return key_hash(key) >> 1;
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state >> 1;
+	}
+
+	void link(node *l, node *r) {
+		if (l) l->nxt = r;
+		if (r) r->pre = l;
+	}
+	void set_root(node *o) {
+		root = o;
+		if (o) o->fa = 0;
+	}
+	/*
+	   the link in the tree that points to o
+	 */
+	node*& link_of(node *o) {
+		if (!o->fa) return root;
+		return o->fa->lc == o ? o->fa->lc : o->fa->rc;
+	}
+	template<class... Args>
+	node* new_node(Args&&... args) {
+		node *x = new node(0, std::forward<Args>(args)...);
+		BalancePolicy::init(*this, x);
+		return x;
+	}
+	/*
+	   the helpers below are what a BalancePolicy works with
+	 */
+	void refresh_up(node *o) {
+		for (; o; o = o->fa)
+			o->update();
+	}
+	/*
+	   a new value in place, the aggregates above it follow
+	 */
+	template<class M>
+	node* assign(node *o, M &&obj) {
+		write_scope w(*this);
+		o->val->second = std::forward<M>(obj);
+		if (augment_field<Augment>::kept)
+			refresh_up(o);
+		return o;
+	}
+	/*
+	   rotate x above its parent
+	 */
+	void rotate_up(node *x) {
+		if (x->fa->lc == x)
+			LL(link_of(x->fa));
+		else
+			RR(link_of(x->fa));
+	}
+	/*
+	   replace x, which has at most one child, by that child.
+	   return the old parent of x.
+	 */
+	node* splice(node *x) {
+		node *c = x->lc ? x->lc : x->rc, *f = x->fa;
+		link_of(x) = c;
+		if (c) c->fa = f;
+		return f;
+	}
+	/*
+	   x has two children: swap the places of x and its successor s,
+	   so that x can be spliced out. nodes move, not values, so
+	   iterators stay valid. r stays with the place.
+	   sizes on the way are stale until the next refresh_up.
+	 */
+	void exchange(node *x) {
+		node *s = leftmost(x->rc), *sf = s->fa, *sr = s->rc;
+		link_of(x) = s;
+		s->fa = x->fa;
+		s->lc = x->lc;
+		s->lc->fa = s;
+		if (sf == x) {
+			s->rc = x;
+			x->fa = s;
 		} else {
-			if (o->lc && o->rc) {
-				if (o->lc->r > o->rc->r) {
-					LL(o); remove(o->rc, key);
+			s->rc = x->rc;
+			s->rc->fa = s;
+			sf->lc = x;
+			x->fa = sf;
+		}
+		x->lc = 0;
+		x->rc = sr;
+		if (sr) sr->fa = x;
+		swap(x->r, s->r);
+	}
+	/*
+	   perfectly balanced tree of a[lo, hi): every level but the last is full.
+	   mark(o, depth) is called once the children of o are done.
+	 */
+	template<class Mark>
+	node* balanced(node **a, int lo, int hi, int depth, Mark mark) {
+		if (lo >= hi) return 0;
+		int mid = (lo + hi) / 2;
+		node *o = a[mid];
+		o->lc = balanced(a, lo, mid, depth + 1, mark);
+		o->rc = balanced(a, mid + 1, hi, depth + 1, mark);
+		o->update();
+		mark(o, depth);
+		return o;
+	}
+	node* spine_build(node **a, int n) {
+		buffer<node*> stk;
+		for (int i = 0; i < n; ++i) {
+			a[i]->lc = a[i]->rc = 0;
+			spine_push(stk, a[i]);
+		}
+		return spine_finish(stk);
+	}
+	/*
+	   append x, whose key is greater than every key before it,
+	   to a treap under construction whose right spine is kept in stk.
+	   nodes popped from the spine are finished and get updated.
+	 */
+	void spine_push(buffer<node*> &stk, node *x) {
+		node *last = 0;
+		while (stk.size() && stk.top()->r < x->r) {
+			last = stk.pop();
+			last->update();
+		}
+		x->lc = last;
+		if (stk.size()) stk.top()->rc = x;
+		stk.push(x);
+	}
+	node* spine_finish(buffer<node*> &stk) {
+		node *o = 0;
+		while (stk.size()) {
+			o = stk.pop();
+			o->update();
+		}
+		return o;
+	}
+	/*
+	   copy copy copy!!
+	   walk the thread of o and build again (a treap keeps its priorities,
+	   so it gets the same shape)
+	 */
+	void copy(const map &o) {
+		buffer<node*> a;
+		node *tmp = 0;
+		for (node *p = o.st; p != o.ed; p = p->nxt) {
+			node *x = new node(p->r, *p->val);
+			if (!tmp) st = x;
+			link(tmp, x); tmp = x;
+			a.push(x);
+		}
+		link(tmp, ed);
+		set_root(BalancePolicy::build(*this, &a[0], a.size()));
+	}
+	/*
+	   clear all data
+	   the thread visits every node, so no recursion is needed
+	 */
+	void make_empty() {
+		node *p = st;
+		while (p != ed) {
+			node *q = p->nxt;
+			dispose(p);
+			p = q;
+		}
+	}
+	/*
+	   return pointer to key
+	   if cannot find, return NULL
+	   in a multimap, the first of the equal keys
+	 */
+	template<class K>
+	node* find(node *o, const K &key) const {
+		if (Multi) {
+			o = lower_bound(o, key);
+			return o != ed && !cmp(key, o->val->first) ? o : 0;
+		}
+		while (o) {
+			int c = three_way(cmp, key, o->val->first);
+			if (c < 0)
+				o = o->lc;
+			else if (c > 0)
+				o = o->rc;
+			else
+				break;
+		}
+		return o;
+	}
+	/*
+	   the lanes of find_many. a step either reads the node (prefetched by
+	   the step before) and prefetches its element, or compares with the
+	   element and prefetches the child. the lanes take turns, so every load
+	   has the other lanes' steps to hide behind.
+	 */
+	static const int batch = 16;
+	void find_group(const Key **k, node **hit, int g) const {
+		node *o[batch];
+		const value_type *v[batch];
+		int live = 0;
+		for (int i = 0; i < g; ++i) {
+			hit[i] = 0;
+			o[i] = root;
+			v[i] = 0;
+			if (root) ++live;
+		}
+		while (live) {
+			for (int i = 0; i < g; ++i) {
+				node *p = o[i];
+				if (!p) continue;
+				if (!v[i]) {
+					v[i] = p->val;
+					__builtin_prefetch(v[i]);
+					continue;
+				}
+				int c = three_way(cmp, *k[i], v[i]->first);
+				if (c < 0) {
+					p = p->lc;
+				} else if (c > 0) {
+					p = p->rc;
 				} else {
-					RR(o); remove(o->lc, key);
+					// a multimap keeps going left to the first of the run
+					hit[i] = p;
+					p = Multi ? p->lc : 0;
 				}
+				o[i] = p;
+				v[i] = 0;
+				if (p) __builtin_prefetch(p);
+				else --live;
+			}
+		}
+	}
+	/*
+	   first node whose key is not less than key, ed if none
+	 */
+	template<class K>
+	node* lower_bound(node *o, const K &key) const {
+		node *res = ed;
+		while (o) {
+			if (cmp(o->val->first, key)) {
+				o = o->rc;
+			} else {
+				res = o;
+				o = o->lc;
+			}
+		}
+		return res;
+	}
+	/*
+	   first node whose key is greater than key, ed if none
+	 */
+	template<class K>
+	node* upper_bound(node *o, const K &key) const {
+		node *res = ed;
+		while (o) {
+			if (cmp(key, o->val->first)) {
+				res = o;
+				o = o->lc;
 			} else {
-				node *tmp = o;
-				if (st == o)
-					st = o->nxt;
-				link(o->pre, o->nxt);
-				if (o->lc)
-					o = o->lc;
-				else
-					o = o->rc;
-				delete tmp;
+				o = o->rc;
 			}
 		}
-		if (o) o->update();
+		return res;
+	}
+	/*
+	   the number of elements before key, or up to and with key if upper
+	 */
+	template<class K>
+	size_t rank_of(const K &key, bool upper) const {
+		size_t k = 0;
+		for (node *o = root; o; ) {
+			if (upper ? !cmp(key, o->val->first) : cmp(o->val->first, key)) {
+				k += node::get_size(o->lc) + 1;
+				o = o->rc;
+			} else {
+				o = o->lc;
+			}
+		}
+		return k;
+	}
+	template<class K>
+	size_t count_of(const K &key) const {
+		if (Multi) return rank_of(key, true) - rank_of(key, false);
+		return size_t(find(root, key) ? 1 : 0);
+	}
+	template<class K>
+	size_t erase_key(const K &key) {
+		if (Multi) {
+			node *l = lower_bound(root, key), *r = upper_bound(root, key);
+			size_t c = 0;
+			for (node *p = l; p != r; p = p->nxt) ++c;
+			if (c) erase(iterator(this, l), iterator(this, r));
+			return c;
+		}
+		node *o = find(root, key);
+		if (!o) return 0;
+		remove(o);
+		return 1;
+	}
+	static node* leftmost(node *o) {
+		while (o->lc) o = o->lc;
+		return o;
+	}
+	static node* rightmost(node *o) {
+		while (o->rc) o = o->rc;
+		return o;
+	}
+	/*
+	   l gets the keys less than key, r gets the rest
+	 */
+	void split(node *o, const Key &key, node *&l, node *&r) {
+		buffer<node*> path;
+		node **pl = &l, **pr = &r;
+		while (o) {
+			path.push(o);
+			if (cmp(o->val->first, key)) {
+				*pl = o;
+				pl = &o->rc;
+				o = o->rc;
+			} else {
+				*pr = o;
+				pr = &o->lc;
+				o = o->lc;
+			}
+		}
+		*pl = *pr = 0;
+		while (path.size())
+			path.pop()->update();
+	}
+	/*
+	   the first k nodes of o go to l, the rest to r
+	 */
+	void split_rank(node *o, int k, node *&l, node *&r) {
+		buffer<node*> path;
+		node **pl = &l, **pr = &r;
+		while (o) {
+			path.push(o);
+			int s = node::get_size(o->lc);
+			if (s < k) {
+				k -= s + 1;
+				*pl = o;
+				pl = &o->rc;
+				o = o->rc;
+			} else {
+				*pr = o;
+				pr = &o->lc;
+				o = o->lc;
+			}
+		}
+		*pl = *pr = 0;
+		while (path.size())
+			path.pop()->update();
+	}
+	/*
+	   like split, but the node equal to key (if any) is cut out into mid
+	 */
+	void split(node *o, const Key &key, node *&l, node *&mid, node *&r) {
+		buffer<node*> path;
+		node **pl = &l, **pr = &r;
+		mid = 0;
+		while (o) {
+			if (cmp(o->val->first, key)) {
+				path.push(o);
+				*pl = o;
+				pl = &o->rc;
+				o = o->rc;
+			} else if (cmp(key, o->val->first)) {
+				path.push(o);
+				*pr = o;
+				pr = &o->lc;
+				o = o->lc;
+			} else {
+				mid = o;
+				break;
+			}
+		}
+		if (mid) {
+			*pl = mid->lc;
+			*pr = mid->rc;
+			mid->lc = mid->rc = 0;
+			mid->update();
+		} else {
+			*pl = *pr = 0;
+		}
+		while (path.size())
+			path.pop()->update();
+	}
+	/*
+	   every key in l must be less than every key in r
+	 */
+	node* join(node *l, node *r) {
+		buffer<node*> path;
+		node *res, **p = &res;
+		while (l && r) {
+			if (l->r > r->r) {
+				*p = l;
+				path.push(l);
+				p = &l->rc;
+				l = l->rc;
+			} else {
+				*p = r;
+				path.push(r);
+				p = &r->lc;
+				r = r->lc;
+			}
+		}
+		*p = l ? l : r;
+		while (path.size())
+			path.pop()->update();
+		return res;
+	}
+	node* join(node *l, node *k, node *r) {
+		k->lc = k->rc = 0;
+		k->update();
+		return join(join(l, k), r);
+	}
+	/*
+	   the set operations rebuild the thread in key order:
+	   last is the last node emitted so far, emit appends a whole subtree
+	   whose own thread is still intact.
+	 */
+	void emit(node *o, node *&last) {
+		if (!o) return;
+		node *x = leftmost(o);
+		if (!last) st = x;
+		link(last, x);
+		last = rightmost(o);
+	}
+	void finish(node *last) {
+		if (!last) st = ed;
+		link(last, ed);
+	}
+	/*
+	   the recursions below follow the shape of the second tree,
+	   so their depth is that of a treap, O(log m) expected.
+	 */
+	node* merge(node *a, node *b, node *&last, buffer<node*> &stk, node *&llast) {
+		if (!b) {
+			emit(a, last);
+			return a;
+		}
+		if (!a) {
+			emit(b, last);
+			return b;
+		}
+		node *bl = b->lc, *br = b->rc, *l, *dup, *r;
+		b->lc = b->rc = 0;
+		split(a, b->val->first, l, dup, r);
+		l = merge(l, bl, last, stk, llast);
+		node *k = b;
+		if (dup) {
+			k = dup;
+			link(llast, b);
+			llast = b;
+			spine_push(stk, b);
+		}
+		emit(k, last);
+		r = merge(r, br, last, stk, llast);
+		return join(l, k, r);
+	}
+	node* unite(node *a, const node *b, node *&last) {
+		if (!b) {
+			emit(a, last);
+			return a;
+		}
+		if (!a) {
+			buffer<node*> stk;
+			const node *p = leftmost(const_cast<node*>(b));
+			for (int i = b->sz; i; --i, p = p->nxt) {
+				node *x = new node(p->r, *p->val);
+				emit(x, last);
+				spine_push(stk, x);
+			}
+			return spine_finish(stk);
+		}
+		node *l, *k, *r;
+		split(a, b->val->first, l, k, r);
+		l = unite(l, b->lc, last);
+		if (!k) {
+			k = new node(b->r, *b->val);
+		}
+		emit(k, last);
+		r = unite(r, b->rc, last);
+		return join(l, k, r);
+	}
+	node* intersect(node *a, const node *b, node *&last) {
+		if (!a) return 0;
+		if (!b) {
+			node *x = leftmost(a);
+			for (int i = a->sz; i; --i) {
+				node *y = x->nxt;
+				dispose(x);
+				x = y;
+			}
+			return 0;
+		}
+		node *l, *k, *r;
+		split(a, b->val->first, l, k, r);
+		l = intersect(l, b->lc, last);
+		emit(k, last);
+		r = intersect(r, b->rc, last);
+		return k ? join(l, k, r) : join(l, r);
+	}
+	node* subtract(node *a, const node *b, node *&last) {
+		if (!a) return 0;
+		if (!b) {
+			emit(a, last);
+			return a;
+		}
+		node *l, *k, *r;
+		split(a, b->val->first, l, k, r);
+		l = subtract(l, b->lc, last);
+		dispose(k);
+		r = subtract(r, b->rc, last);
+		return join(l, r);
+	}
+	void LL(node *&o) { // left rotate
+		node *k = o->lc;
+		k->fa = o->fa;
+		o->lc = k->rc;
+		k->rc = o;
+		o->update();
+		k->update();
+		o = k;
+	}
+	void RR(node *&o) { // right rotate
+		node *k = o->rc;
+		k->fa = o->fa;
+		o->rc = k->lc;
+		k->lc = o;
+		o->update();
+		k->update();
+		o = k;
+	}
+
+	/*
+	   the k-th (from 1) node of the subtree o, NULL if there are not enough
+	 */
+	node *get_kth(node *o, int k) const {
+		if (k < 1 || node::get_size(o) < k) return 0;
+		while (true) {
+			int s = node::get_size(o->lc);
+			if (k == s + 1)
+				return o;
+			if (k <= s) {
+				o = o->lc;
+			} else {
+				k -= s + 1;
+				o = o->rc;
+			}
+		}
+	}
+	/*
+	   number of nodes before x, walking up through the parent pointers.
+	   ed is after every node.
+	 */
+	int position(const node *x) const {
+		if (x == ed) return node::get_size(root);
+		int k = node::get_size(x->lc);
+		for (; x->fa; x = x->fa)
+			if (x->fa->rc == x)
+				k += node::get_size(x->fa->lc) + 1;
+		return k;
+	}
+
+	/*
+	   walk down from the root and hang the new node under a leaf
+	 */
+	/*
+	   the empty child link where key belongs, with its parent f and the
+	   neighbours l, r on the thread. null if key is already there, at f.
+	   a multimap goes right past equal keys, after the last of them
+	 */
+	node** slot_for(const Key &key, node *&f, node *&l, node *&r) {
+		node **p = &root;
+		f = l = 0;
+		r = ed;
+		while (*p) {
+			f = *p;
+			int c = three_way(cmp, key, f->val->first);
+			if (c < 0) {
+				r = f;
+				p = &f->lc;
+			} else if (c > 0 || Multi) {
+				l = f;
+				p = &f->rc;
+			} else {
+				return 0;
+			}
+		}
+		return p;
+	}
+	void attach(node **p, node *x, node *f, node *l, node *r) {
+		write_scope w(*this);
+		*p = x;
+		x->fa = f;
+		if (!l) st = x;
+		link(l, x);
+		link(x, r);
+		BalancePolicy::attached(*this, x);
+	}
+	pair<node*, bool> insert_node(const value_type &value) {
+		node *f, *l, *r, **p = slot_for(value.first, f, l, r);
+		if (!p) return pair<node*, bool>(f, false);
+		node *x = new_node(value);
+		attach(p, x, f, l, r);
+		return pair<node*, bool>(x, true);
+	}
+
+	/*
+	   insert value next to h (h may be ed) if its key really belongs
+	   between h->pre and h, or between h and h->nxt.
+	   two neighbours on the thread always leave a free child slot
+	   for the node between them: r->lc, or else l->rc.
+	 */
+	pair<node*, bool> insert_near(node *h, const value_type &value) {
+		node *l, *r;
+		if (node *e = next_to(h, value.first, l, r))
+			return pair<node*, bool>(e, false);
+		if (!r) return insert_node(value);
+		return pair<node*, bool>(hang(new_node(value), l, r), true);
+	}
+	/*
+	   the same with a node already built, freed if its key is there
+	 */
+	pair<node*, bool> insert_near(node *h, node *x) {
+		node *l, *r;
+		if (node *e = next_to(h, x->val->first, l, r)) {
+			delete x;
+			return pair<node*, bool>(e, false);
+		}
+		if (!r) {
+			node *f, **p = slot_for(x->val->first, f, l, r);
+			if (!p) {
+				delete x;
+				return pair<node*, bool>(f, false);
+			}
+			attach(p, x, f, l, r);
+			return pair<node*, bool>(x, true);
+		}
+		return pair<node*, bool>(hang(x, l, r), true);
+	}
+	/*
+	   the neighbours l, r on the thread if key belongs next to h, r is 0
+	   if it does not. returns h when h holds key in a unique map
+	 */
+	node* next_to(node *h, const Key &key, node *&l, node *&r) {
+		l = r = 0;
+		if (h == ed || cmp(key, h->val->first)) {
+			if (!h->pre || cmp(h->pre->val->first, key)) {
+				l = h->pre;
+				r = h;
+			}
+		} else if (cmp(h->val->first, key)) {
+			if (h->nxt == ed || cmp(key, h->nxt->val->first)) {
+				l = h;
+				r = h->nxt;
+			}
+		} else if (!Multi) {
+			return h;
+		}
+		return 0;
+	}
+	/*
+	   hang x between its neighbours l and r on the thread
+	 */
+	node* hang(node *x, node *l, node *r) {
+		write_scope w(*this);
+		if (!root)
+			set_root(x);
+		else if (r != ed && !r->lc)
+			r->lc = x, x->fa = r;
+		else
+			l->rc = x, x->fa = l;
+		if (!l) st = x;
+		link(l, x);
+		link(x, r);
+		BalancePolicy::attached(*this, x);
+		return x;
+	}
+
+	/*
+	   take x out of the tree and the thread, x itself is left alone
+	 */
+	void unlink(node *x) {
+		write_scope w(*this);
+		BalancePolicy::detach(*this, x);
+		if (st == x)
+			st = x->nxt;
+		link(x->pre, x->nxt);
+	}
+	void remove(node *x) {
+		unlink(x);
+		dispose(x);
+	}
+	/*
+	   a node from another map, made a fresh leaf of this one
+	 */
+	void adopt(node *x) {
+		x->lc = x->rc = x->fa = x->pre = x->nxt = 0;
+		x->sz = 1;
+		x->pull(0, 0, *x->val);
+		BalancePolicy::init(*this, x);
 	}
 };
 
+/**
+ * a map that keeps every element inserted, equal keys included.
+ *
+ * equal keys sit in the order they came in: an insert goes right past
+ *   the equal keys already there. so insert always succeeds (the second
+ *   of its result is true), find and extract take the first of the equal
+ *   keys, erase(key) erases all of them, equal_range is two descents and
+ *   count(key) is the difference of two ranks from the subtree sizes.
+ * what needs one value per key (at, operator[], try_emplace,
+ *   insert_or_assign, the set operations) does not compile.
+ */
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>,
+	class BalancePolicy = treap_balance,
+	class Augment = no_augment
+> using multimap = map<Key, T, Compare, BalancePolicy, Augment, true>;
+
 }
 
 #endif
@@ -0,0 +1,204 @@
+/**
+ * implement a container like std::multiset
+ */
+#ifndef SJTU_MULTISET_HPP
+#define SJTU_MULTISET_HPP
+
+// only for std::less<T>
+#include <functional>
+#include <cstddef>
+#include "utility.hpp"
+#include "exceptions.hpp"
+#include "map.hpp"
+
+namespace sjtu {
+
+/**
+ * a sorted bag of keys, a multimap with nothing mapped.
+ *
+ * the tree, its balancing and its thread are those of sjtu::map, so equal
+ *   keys stay in the order they came in, count(key) is O(log n) from the
+ *   subtree sizes and equal_range is two descents.
+ * keys are read only through the iterators.
+ */
+template<
+	class Key,
+	class Compare = std::less<Key>,
+	class BalancePolicy = treap_balance
+> class multiset {
+private:
+	struct none {};
+	typedef multimap<Key, none, Compare, BalancePolicy> tree;
+
+public:
+	typedef Key value_type;
+
+	/**
+	 * see BidirectionalIterator at CppReference for help.
+	 *
+	 * if there is anything wrong throw invalid_iterator.
+	 *     like it = set.begin(); --it;
+	 *       or it = set.end(); ++end();
+	 */
+	class const_iterator {
+		friend class multiset;
+	private:
+		typename tree::iterator it;
+		explicit const_iterator(const typename tree::iterator &it): it(it) {}
+
+	public:
+		const_iterator() {}
+		/**
+		 * iter++
+		 */
+		const_iterator operator++(int) {
+			return const_iterator(it++);
+		}
+		/**
+		 * ++iter
+		 */
+		const_iterator& operator++() {
+			++it;
+			return *this;
+		}
+		/**
+		 * iter--
+		 */
+		const_iterator operator--(int) {
+			return const_iterator(it--);
+		}
+		/**
+		 * --iter
+		 */
+		const_iterator& operator--() {
+			--it;
+			return *this;
+		}
+		const Key& operator*() const {
+			return it->first;
+		}
+		const Key* operator->() const noexcept {
+			return &it->first;
+		}
+		bool operator==(const const_iterator &rhs) const {
+			return it == rhs.it;
+		}
+		bool operator!=(const const_iterator &rhs) const {
+			return it != rhs.it;
+		}
+	};
+	typedef const_iterator iterator;
+
+	multiset() {}
+	/**
+	 * build from a range, in O(n) if it is sorted, see map::build_sorted.
+	 */
+	template<class InputIterator>
+	multiset(InputIterator first, InputIterator last) {
+		t.build_sorted(keyed<InputIterator>(first), keyed<InputIterator>(last));
+	}
+	const_iterator begin() const {
+		return const_iterator(const_cast<tree&>(t).begin());
+	}
+	const_iterator cbegin() const {
+		return begin();
+	}
+	const_iterator end() const {
+		return const_iterator(const_cast<tree&>(t).end());
+	}
+	const_iterator cend() const {
+		return end();
+	}
+	bool empty() const {
+		return t.empty();
+	}
+	size_t size() const {
+		return t.size();
+	}
+	void clear() {
+		t.clear();
+	}
+	/**
+	 * insert key after the keys equal to it, return where it went.
+	 */
+	const_iterator insert(const Key &key) {
+		return const_iterator(t.insert(typename tree::value_type(key, none())).first);
+	}
+	template<class InputIterator>
+	void insert(InputIterator first, InputIterator last) {
+		for (; first != last; ++first)
+			insert(*first);
+	}
+	/**
+	 * erase the key at pos.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(const_iterator pos) {
+		t.erase(pos.it);
+	}
+	/**
+	 * erase the keys in [first, last), return last.
+	 */
+	const_iterator erase(const_iterator first, const_iterator last) {
+		return const_iterator(t.erase(first.it, last.it));
+	}
+	/**
+	 * erase every key equal to key, return how many there were.
+	 */
+	size_t erase(const Key &key) {
+		return t.erase(key);
+	}
+	size_t count(const Key &key) const {
+		return t.count(key);
+	}
+	/**
+	 * the first key equal to key, or end().
+	 */
+	const_iterator find(const Key &key) const {
+		return const_iterator(const_cast<tree&>(t).find(key));
+	}
+	const_iterator lower_bound(const Key &key) const {
+		return const_iterator(const_cast<tree&>(t).lower_bound(key));
+	}
+	const_iterator upper_bound(const Key &key) const {
+		return const_iterator(const_cast<tree&>(t).upper_bound(key));
+	}
+	pair<const_iterator, const_iterator> equal_range(const Key &key) const {
+		auto r = const_cast<tree&>(t).equal_range(key);
+		return pair<const_iterator, const_iterator>(const_iterator(r.first), const_iterator(r.second));
+	}
+	/**
+	 * the number of keys less than key.
+	 */
+	int index_of(const Key &key) const {
+		return t.index_of(key);
+	}
+
+private:
+	tree t;
+
+	/*
+	   walks the input, giving (key, none) pairs for the tree
+	 */
+	template<class InputIterator>
+	struct keyed {
+		InputIterator i;
+
+		explicit keyed(InputIterator i): i(i) {}
+		typename tree::value_type operator*() const {
+			return typename tree::value_type(*i, none());
+		}
+		keyed& operator++() {
+			++i;
+			return *this;
+		}
+		bool operator!=(const keyed &o) const {
+			return i != o.i;
+		}
+	};
+};
+
+}
+
+#endif
@@ -0,0 +1,459 @@
+/**
+ * implement a map whose copies are snapshots
+ */
+#ifndef SJTU_PERSISTENT_MAP_HPP
+#define SJTU_PERSISTENT_MAP_HPP
+
+// only for std::less<T>
+#include <functional>
+#include <cstddef>
+#include <utility>
+#include "utility.hpp"
+#include "exceptions.hpp"
+
+namespace sjtu {
+
+/**
+ * a treap map where copying is O(1) and every copy is a snapshot.
+ *
+ * versions share their nodes, each node counts the versions and parents
+ *   pointing at it. an update copies only the shared nodes on its path
+ *   (O(log n) expected), a node that belongs to this version alone is
+ *   changed in place, so a map nobody has copied updates like sjtu::map.
+ *
+ * elements are read only: change a value with insert_or_assign.
+ * a node can be in many trees, so there is no pre/nxt thread, iterators
+ *   keep the path from the root instead. they stay valid as long as the
+ *   version they came from is not changed or destroyed, a snapshot taken
+ *   before an update keeps all of its iterators.
+ * the counts are plain ints: versions can be read from many threads,
+ *   but copied or changed from one at a time.
+ */
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>
+> class persistent_map {
+public:
+	typedef pair<const Key, T> value_type;
+
+private:
+	struct node {
+		value_type val;
+		node *lc, *rc;
+		unsigned pri;
+		int refs;
+
+		template<class... Args>
+		node(unsigned pri, Args&&... args): val(std::forward<Args>(args)...), lc(0), rc(0), pri(pri), refs(1) {}
+		/*
+		   a private copy, the children gain a parent
+		 */
+		node(const node &o): val(o.val), lc(o.lc), rc(o.rc), pri(o.pri), refs(1) {
+			if (lc) ++lc->refs;
+			if (rc) ++rc->refs;
+		}
+	};
+
+public:
+	/**
+	 * see BidirectionalIterator at CppReference for help.
+	 *
+	 * if there is anything wrong throw invalid_iterator.
+	 *     like it = map.begin(); --it;
+	 *       or it = map.end(); ++end();
+	 */
+	class const_iterator {
+		friend class persistent_map;
+	private:
+		static const int inline_depth = 48;
+		node *root;
+		node *local[inline_depth];
+		node **a; // a[0] is root, a[n - 1] the current node, empty for end()
+		int n, cap;
+
+		void push(node *o) {
+			if (n == cap) {
+				node **b = new node*[cap * 2];
+				for (int i = 0; i < n; ++i)
+					b[i] = a[i];
+				if (a != local) delete [] a;
+				a = b;
+				cap *= 2;
+			}
+			a[n++] = o;
+		}
+		void assign(const const_iterator &o) {
+			root = o.root;
+			n = 0;
+			for (int i = 0; i < o.n; ++i)
+				push(o.a[i]);
+		}
+		void dive_left(node *o) {
+			for (; o; o = o->lc) push(o);
+		}
+		void dive_right(node *o) {
+			for (; o; o = o->rc) push(o);
+		}
+
+	public:
+		const_iterator(): root(0), a(local), n(0), cap(inline_depth) {}
+		explicit const_iterator(node *root): root(root), a(local), n(0), cap(inline_depth) {}
+		const_iterator(const const_iterator &o): a(local), cap(inline_depth) {
+			assign(o);
+		}
+		const_iterator& operator=(const const_iterator &o) {
+			if (this != &o) assign(o);
+			return *this;
+		}
+		~const_iterator() {
+			if (a != local) delete [] a;
+		}
+		/**
+		 * iter++
+		 */
+		const_iterator operator++(int) {
+			const_iterator tmp = *this;
+			++(*this);
+			return tmp;
+		}
+		/**
+		 * ++iter
+		 */
+		const_iterator& operator++() {
+			if (!n)
+				throw invalid_iterator();
+			node *o = a[n - 1];
+			if (o->rc) {
+				dive_left(o->rc);
+				return *this;
+			}
+			// climb while coming up from a right child
+			while (--n && a[n - 1]->rc == o)
+				o = a[n - 1];
+			return *this;
+		}
+		/**
+		 * iter--
+		 */
+		const_iterator operator--(int) {
+			const_iterator tmp = *this;
+			--(*this);
+			return tmp;
+		}
+		/**
+		 * --iter
+		 */
+		const_iterator& operator--() {
+			if (!n) {
+				if (!root)
+					throw invalid_iterator();
+				dive_right(root);
+				return *this;
+			}
+			node *o = a[n - 1];
+			if (o->lc) {
+				dive_right(o->lc);
+				return *this;
+			}
+			int m = n;
+			while (--m && a[m - 1]->lc == o)
+				o = a[m - 1];
+			if (!m)
+				throw invalid_iterator(); // was begin()
+			n = m;
+			return *this;
+		}
+		const value_type& operator*() const {
+			return a[n - 1]->val;
+		}
+		const value_type* operator->() const noexcept {
+			return &a[n - 1]->val;
+		}
+		/**
+		 * a operator to check whether two iterators are same (pointing to the same memory).
+		 */
+		bool operator==(const const_iterator &rhs) const {
+			return root == rhs.root && (n ? a[n - 1] : 0) == (rhs.n ? rhs.a[rhs.n - 1] : 0);
+		}
+		bool operator!=(const const_iterator &rhs) const {
+			return !(*this == rhs);
+		}
+	};
+	typedef const_iterator iterator;
+
+	persistent_map(): root(0), n(0), state(scramble((size_t)this)) {}
+	/**
+	 * a snapshot: O(1), the nodes are shared until one side changes them.
+	 */
+	persistent_map(const persistent_map &o): root(o.root), n(o.n), state(scramble((size_t)this)), cmp(o.cmp) {
+		if (root) ++root->refs;
+	}
+	persistent_map& operator=(const persistent_map &o) {
+		if (o.root) ++o.root->refs;
+		release(root);
+		root = o.root;
+		n = o.n;
+		cmp = o.cmp;
+		return *this;
+	}
+	~persistent_map() {
+		release(root);
+	}
+	/**
+	 * the same as a copy, for call sites that want to say so.
+	 */
+	persistent_map snapshot() const {
+		return *this;
+	}
+	/**
+	 * access specified element with bounds checking
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	const T& at(const Key &key) const {
+		node *o = find_node(key);
+		if (!o)
+			throw index_out_of_bound();
+		return o->val.second;
+	}
+	const T& operator[](const Key &key) const {
+		return at(key);
+	}
+	const_iterator begin() const {
+		const_iterator it(root);
+		it.dive_left(root);
+		return it;
+	}
+	const_iterator cbegin() const {
+		return begin();
+	}
+	const_iterator end() const {
+		return const_iterator(root);
+	}
+	const_iterator cend() const {
+		return end();
+	}
+	bool empty() const {
+		return !n;
+	}
+	size_t size() const {
+		return n;
+	}
+	/**
+	 * drop this version, the nodes still used by other versions stay.
+	 */
+	void clear() {
+		release(root);
+		root = 0;
+		n = 0;
+	}
+	size_t count(const Key &key) const {
+		return size_t(find_node(key) ? 1 : 0);
+	}
+	/**
+	 * Finds an element with key equivalent to key.
+	 *   If no such element is found, past-the-end (see end()) iterator is returned.
+	 */
+	const_iterator find(const Key &key) const {
+		const_iterator it(root);
+		for (node *o = root; o; ) {
+			it.push(o);
+			int c = three_way(cmp, key, o->val.first);
+			if (!c) return it;
+			o = c < 0 ? o->lc : o->rc;
+		}
+		return end();
+	}
+	/**
+	 * Returns an iterator to the first element whose key is not less than key,
+	 *   or end() if there is no such element.
+	 */
+	const_iterator lower_bound(const Key &key) const {
+		const_iterator it(root);
+		int keep = 0;
+		for (node *o = root; o; ) {
+			it.push(o);
+			if (cmp(o->val.first, key)) {
+				o = o->rc;
+			} else {
+				keep = it.n;
+				o = o->lc;
+			}
+		}
+		it.n = keep;
+		return it;
+	}
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<const_iterator, bool> insert(const value_type &value) {
+		if (find_node(value.first))
+			return pair<const_iterator, bool>(find(value.first), false);
+		put(new node(priority(), value));
+		return pair<const_iterator, bool>(find(value.first), true);
+	}
+	/**
+	 * set the value of key, inserting it if it is missing.
+	 *   the second of the result is true for an insertion.
+	 */
+	template<class M>
+	pair<const_iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+		if (!find_node(key)) {
+			put(new node(priority(), key, std::forward<M>(obj)));
+			return pair<const_iterator, bool>(find(key), true);
+		}
+		node **p = &root;
+		for (;;) {
+			node *o = *p = unshare(*p);
+			int c = three_way(cmp, key, o->val.first);
+			if (!c) {
+				o->val.second = std::forward<M>(obj);
+				break;
+			}
+			p = c < 0 ? &o->lc : &o->rc;
+		}
+		return pair<const_iterator, bool>(find(key), false);
+	}
+	/**
+	 * erase the element with key, return the number of elements erased (0 or 1).
+	 */
+	size_t erase(const Key &key) {
+		if (!find_node(key)) return 0;
+		node **p = &root, *o;
+		for (;;) {
+			o = *p = unshare(*p);
+			int c = three_way(cmp, key, o->val.first);
+			if (!c) break;
+			p = c < 0 ? &o->lc : &o->rc;
+		}
+		*p = join(o->lc, o->rc);
+		o->lc = o->rc = 0;
+		release(o);
+		--n;
+		return 1;
+	}
+	/**
+	 * erase the element at pos.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(const_iterator pos) {
+		if (!pos.n || pos.root != root) throw invalid_iterator();
+		erase(pos->first);
+	}
+
+private:
+	node *root;
+	size_t n;
+	unsigned state;
+	Compare cmp;
+
+	unsigned priority() {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+	node* find_node(const Key &key) const {
+		node *o = root;
+		while (o) {
+			int c = three_way(cmp, key, o->val.first);
+			if (!c) break;
+			o = c < 0 ? o->lc : o->rc;
+		}
+		return o;
+	}
+	/*
+	   the link to o holds one of its counts. if other links hold the rest,
+	   that link gets a private copy instead
+	 */
+	static node* unshare(node *o) {
+		if (o->refs == 1) return o;
+		node *c = new node(*o);
+		--o->refs;
+		return c;
+	}
+	/*
+	   drop one count of o, freeing what is no longer used by anyone
+	 */
+	static void release(node *o) {
+		node *stk[64], **a = stk;
+		int top = 0, cap = 64;
+		while (o || top) {
+			if (!o) o = a[--top];
+			if (--o->refs) {
+				o = 0;
+				continue;
+			}
+			if (o->rc) {
+				if (top == cap) {
+					node **b = new node*[cap * 2];
+					for (int i = 0; i < top; ++i)
+						b[i] = a[i];
+					if (a != stk) delete [] a;
+					a = b;
+					cap *= 2;
+				}
+				a[top++] = o->rc;
+			}
+			node *l = o->lc;
+			delete o;
+			o = l;
+		}
+		if (a != stk) delete [] a;
+	}
+	/*
+	   hang x (whose key is not in the map) where its priority puts it,
+	   the subtree it lands on is split around its key
+	 */
+	void put(node *x) {
+		node **p = &root;
+		while (*p && (*p)->pri > x->pri) {
+			node *o = *p = unshare(*p);
+			p = cmp(x->val.first, o->val.first) ? &o->lc : &o->rc;
+		}
+		node *o = *p, **l = &x->lc, **r = &x->rc;
+		while (o) {
+			o = unshare(o);
+			if (cmp(o->val.first, x->val.first)) {
+				*l = o;
+				l = &o->rc;
+				o = o->rc;
+			} else {
+				*r = o;
+				r = &o->lc;
+				o = o->lc;
+			}
+		}
+		*l = *r = 0;
+		*p = x;
+		++n;
+	}
+	/*
+	   every key of a is less than every key of b, the counts held by the
+	   two links move to the result
+	 */
+	static node* join(node *a, node *b) {
+		node *res, **p = &res;
+		while (a && b) {
+			if (a->pri > b->pri) {
+				a = *p = unshare(a);
+				p = &a->rc;
+				a = a->rc;
+			} else {
+				b = *p = unshare(b);
+				p = &b->lc;
+				b = b->lc;
+			}
+		}
+		*p = a ? a : b;
+		return res;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,440 @@
+/**
+ * implement a read-only map for lookups after it is built
+ */
+#ifndef SJTU_STATIC_MAP_HPP
+#define SJTU_STATIC_MAP_HPP
+
+// only for std::less<T>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include "utility.hpp"
+#include "exceptions.hpp"
+
+namespace sjtu {
+
+/**
+ * an immutable map, built once from a sorted sequence.
+ *
+ * the keys are stored in Eytzinger (BFS) order: the children of slot k
+ *   are 2k and 2k + 1, the values sit in a parallel array.
+ *   a lookup goes down with k = 2k + (key[k] < key), a compare and an add
+ *   with no branch to mispredict, and prefetches the cache line holding
+ *   the descendants a few levels below (four for int keys), so the loads of later levels
+ *   overlap with the compares of the current ones.
+ *
+ * subtree sizes follow from n alone, so iteration in key order,
+ *   rank, nth and index_of still work in O(log n) without extra arrays.
+ *   like flat_map, *it is a pair<const Key&, const T&> made on the fly.
+ */
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>
+> class static_map {
+public:
+	typedef pair<const Key, T> value_type;
+
+	class const_iterator {
+		friend class static_map;
+	public:
+		typedef pair<const Key&, const T&> reference;
+		struct pointer {
+			reference r;
+			reference* operator->() {
+				return &r;
+			}
+		};
+	private:
+		const static_map *self;
+		size_t k; // slot in BFS order, 0 for end()
+
+	public:
+		const_iterator(): self(0), k(0) {}
+		const_iterator(const static_map *self, size_t k): self(self), k(k) {}
+		/**
+		 * return a new iterator which pointer n-next elements,
+		 *   through the rank in O(log n).
+		 * moving before begin() or past end() throws invalid_iterator.
+		 */
+		const_iterator operator+(int n) const {
+			if (!self) throw invalid_iterator();
+			long long r = (long long)self->position(k) + n;
+			if (r < 0 || r > (long long)self->n) throw invalid_iterator();
+			return const_iterator(self, self->slot_of(r));
+		}
+		const_iterator operator-(int n) const {
+			return *this + (-n);
+		}
+		/**
+		 * distance between two iterators of the same map.
+		 */
+		int operator-(const const_iterator &rhs) const {
+			if (!self || self != rhs.self) throw invalid_iterator();
+			return int(self->position(k)) - int(self->position(rhs.k));
+		}
+		/**
+		 * iter++
+		 */
+		const_iterator operator++(int) {
+			const_iterator tmp = *this;
+			++(*this);
+			return tmp;
+		}
+		/**
+		 * ++iter
+		 */
+		const_iterator& operator++() {
+			if (!self || !k)
+				throw invalid_iterator();
+			k = self->next(k);
+			return *this;
+		}
+		/**
+		 * iter--
+		 */
+		const_iterator operator--(int) {
+			const_iterator tmp = *this;
+			--(*this);
+			return tmp;
+		}
+		/**
+		 * --iter
+		 */
+		const_iterator& operator--() {
+			if (!self)
+				throw invalid_iterator();
+			size_t p = self->prev(k);
+			if (!p)
+				throw invalid_iterator();
+			k = p;
+			return *this;
+		}
+		reference operator*() const {
+			return reference(self->keys[k], self->vals[k]);
+		}
+		pointer operator->() const {
+			pointer p = {**this};
+			return p;
+		}
+		bool operator==(const const_iterator &rhs) const {
+			return self == rhs.self && k == rhs.k;
+		}
+		bool operator!=(const const_iterator &rhs) const {
+			return !(*this == rhs);
+		}
+	};
+	typedef const_iterator iterator;
+
+	static_map(): raw(0), keys(0), vals(0), n(0), h(0) {}
+	static_map(const static_map &o): raw(0), keys(0), vals(0), n(0), h(0), cmp(o.cmp) {
+		allocate(o.n);
+		for (size_t k = 1; k <= n; ++k) {
+			new (keys + k) Key(o.keys[k]);
+			new (vals + k) T(o.vals[k]);
+		}
+	}
+	/**
+	 * freeze any map that iterates in key order
+	 *   (sjtu::map, btree_map, flat_map) in O(n).
+	 */
+	template<class Map>
+	explicit static_map(const Map &m): raw(0), keys(0), vals(0), n(0), h(0) {
+		build(m.size(), m.cbegin(), m.cend());
+	}
+	/**
+	 * build from a range sorted by key without repeated keys, in O(n).
+	 * the counting pass also checks the order: a range out of order (or
+	 *   with a repeated key) is sorted first in O(n log n), keeping the
+	 *   first of equal keys, so it still gives the right map.
+	 */
+	template<class ForwardIterator>
+	static_map(sorted_unique_t, ForwardIterator first, ForwardIterator last): raw(0), keys(0), vals(0), n(0), h(0) {
+		size_t c = 0;
+		bool sorted = true;
+		for (ForwardIterator i = first, p = first; i != last; p = i, ++i, ++c)
+			if (c && !cmp((*p).first, (*i).first)) sorted = false;
+		if (sorted)
+			build(c, first, last);
+		else
+			build_unsorted(c, first, last);
+	}
+	static_map& operator=(const static_map &o) {
+		if (this == &o) {
+			return *this;
+		}
+		static_map tmp(o);
+		swap(tmp);
+		return *this;
+	}
+	~static_map() {
+		for (size_t k = 1; k <= n; ++k) {
+			keys[k].~Key();
+			vals[k].~T();
+		}
+		::operator delete(raw);
+	}
+	void swap(static_map &o) {
+		exchange(raw, o.raw);
+		exchange(keys, o.keys);
+		exchange(vals, o.vals);
+		exchange(n, o.n);
+		exchange(h, o.h);
+		exchange(cmp, o.cmp);
+	}
+	/**
+	 * access specified element with bounds checking
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	const T& at(const Key &key) const {
+		size_t k = lower_slot(key);
+		if (!k || cmp(key, keys[k]))
+			throw index_out_of_bound();
+		return vals[k];
+	}
+	const T& operator[](const Key &key) const {
+		return at(key);
+	}
+	const_iterator begin() const {
+		return const_iterator(this, first_slot());
+	}
+	const_iterator cbegin() const {
+		return begin();
+	}
+	const_iterator end() const {
+		return const_iterator(this, 0);
+	}
+	const_iterator cend() const {
+		return end();
+	}
+	bool empty() const {
+		return !n;
+	}
+	size_t size() const {
+		return n;
+	}
+	size_t count(const Key &key) const {
+		size_t k = lower_slot(key);
+		return size_t(k && !cmp(key, keys[k]) ? 1 : 0);
+	}
+	const_iterator find(const Key &key) const {
+		size_t k = lower_slot(key);
+		if (!k || cmp(key, keys[k])) return end();
+		return const_iterator(this, k);
+	}
+	/**
+	 * Returns an iterator to the first element whose key is not less than key,
+	 *   or end() if there is no such element.
+	 */
+	const_iterator lower_bound(const Key &key) const {
+		return const_iterator(this, lower_slot(key));
+	}
+	/**
+	 * Returns an iterator to the first element whose key is greater than key,
+	 *   or end() if there is no such element.
+	 */
+	const_iterator upper_bound(const Key &key) const {
+		size_t k = 1;
+		while (k <= n) {
+			prefetch(k);
+			k = 2 * k + !cmp(key, keys[k]);
+		}
+		return const_iterator(this, k >> (__builtin_ctzll(~(unsigned long long)k) + 1));
+	}
+	/*
+	   Find the element position at k-th if sorted
+	   If no such element is found, past-the-end (see end()) iterator is returned.
+	 */
+	const_iterator rank(int k) const {
+		if (k < 1 || k > (int)n) return end();
+		return const_iterator(this, slot_of(k - 1));
+	}
+	/**
+	 * the element at position k (from 0), end() if k >= size().
+	 */
+	const_iterator nth(int k) const {
+		if (k < 0 || k >= (int)n) return end();
+		return const_iterator(this, slot_of(k));
+	}
+	/**
+	 * the number of elements whose key is less than key,
+	 *   which is the position of key if it is in the map.
+	 */
+	int index_of(const Key &key) const {
+		return position(lower_slot(key));
+	}
+	/**
+	 * the position of the element it points to, size() for end().
+	 */
+	int index_of(const_iterator it) const {
+		if (it.self != this) throw invalid_iterator();
+		return position(it.k);
+	}
+
+private:
+	// the descendants of slot k log2(per_line) levels down fill the cache line at keys[k * per_line]
+	static const size_t line = 64;
+	static const size_t per_line = sizeof(Key) < line ? line / sizeof(Key) : 1;
+
+	void *raw;
+	Key *keys; // keys[1..n], keys[0] is unused and starts a cache line
+	T *vals;   // vals[1..n]
+	size_t n;
+	int h;     // depth of the last level
+	Compare cmp;
+
+	template<class U>
+	static void exchange(U &x, U &y) {
+		U z = x;
+		x = y;
+		y = z;
+	}
+	void allocate(size_t c) {
+		n = c;
+		h = 0;
+		while ((size_t(2) << h) <= n) ++h;
+		raw = ::operator new((n + 1) * sizeof(Key) + (n + 1) * sizeof(T) + alignof(T) + line);
+		uintptr_t p = reinterpret_cast<uintptr_t>(raw);
+		p = (p + line - 1) / line * line;
+		keys = reinterpret_cast<Key*>(p);
+		p += (n + 1) * sizeof(Key);
+		p = (p + alignof(T) - 1) / alignof(T) * alignof(T);
+		vals = reinterpret_cast<T*>(p);
+	}
+	/*
+	   an in-order walk of the slots takes the elements in key order
+	 */
+	template<class InputIterator>
+	void build(size_t c, InputIterator first, InputIterator last) {
+		allocate(c);
+		for (size_t k = first_slot(); first != last && k; ++first, k = next(k)) {
+			new (keys + k) Key((*first).first);
+			new (vals + k) T((*first).second);
+		}
+	}
+	/*
+	   the elements by a stable merge sort of their iterators,
+	   the first of every run of equal keys is kept
+	 */
+	template<class ForwardIterator>
+	void build_unsorted(size_t c, ForwardIterator first, ForwardIterator last) {
+		ForwardIterator *at = static_cast<ForwardIterator*>(::operator new(c * sizeof(ForwardIterator)));
+		size_t *p = new size_t[c], *q = new size_t[c], m = 0;
+		for (; first != last; ++first, ++m) {
+			new (at + m) ForwardIterator(first);
+			p[m] = m;
+		}
+		for (size_t w = 1; w < c; w *= 2) {
+			for (size_t lo = 0; lo < c; lo += 2 * w) {
+				size_t mid = lo + w < c ? lo + w : c, hi = lo + 2 * w < c ? lo + 2 * w : c;
+				size_t i = lo, j = mid, o = lo;
+				while (i < mid && j < hi)
+					q[o++] = cmp((*at[p[j]]).first, (*at[p[i]]).first) ? p[j++] : p[i++];
+				while (i < mid) q[o++] = p[i++];
+				while (j < hi) q[o++] = p[j++];
+			}
+			size_t *t = p;
+			p = q;
+			q = t;
+		}
+		m = 0;
+		for (size_t i = 0; i < c; ++i)
+			if (!m || cmp((*at[p[m - 1]]).first, (*at[p[i]]).first)) p[m++] = p[i];
+		allocate(m);
+		size_t i = 0;
+		for (size_t k = first_slot(); k; k = next(k), ++i) {
+			new (keys + k) Key((*at[p[i]]).first);
+			new (vals + k) T((*at[p[i]]).second);
+		}
+		for (size_t i = 0; i < c; ++i)
+			at[i].~ForwardIterator();
+		::operator delete(at);
+		delete [] p;
+		delete [] q;
+	}
+	void prefetch(size_t k) const {
+		// only an address hint, it may point past the array
+		__builtin_prefetch(reinterpret_cast<const void*>(reinterpret_cast<uintptr_t>(keys) + k * per_line * sizeof(Key)));
+	}
+	/*
+	   the path of the descent is the bits of k, the trailing ones are the
+	   right turns after the last left turn, which was at the answer
+	 */
+	size_t lower_slot(const Key &key) const {
+		size_t k = 1;
+		while (k <= n) {
+			prefetch(k);
+			k = 2 * k + cmp(keys[k], key);
+		}
+		return k >> (__builtin_ctzll(~(unsigned long long)k) + 1);
+	}
+	/*
+	   every level above h is full, so a subtree is a perfect tree
+	   plus a run of the last level
+	 */
+	size_t subtree(size_t k) const {
+		if (k > n) return 0;
+		int d = 0;
+		while ((size_t(2) << d) <= k) ++d;
+		size_t w = size_t(1) << (h - d), lo = k << (h - d);
+		size_t last = n < lo ? 0 : (n - lo + 1 < w ? n - lo + 1 : w);
+		return w - 1 + last;
+	}
+	size_t position(size_t k) const {
+		if (!k) return n;
+		size_t r = subtree(2 * k);
+		for (; k > 1; k >>= 1)
+			if (k & 1) r += subtree(k - 1) + 1;
+		return r;
+	}
+	size_t slot_of(size_t r) const {
+		size_t k = 1;
+		while (k <= n) {
+			size_t l = subtree(2 * k);
+			if (r == l) return k;
+			if (r < l) {
+				k = 2 * k;
+			} else {
+				r -= l + 1;
+				k = 2 * k + 1;
+			}
+		}
+		return 0;
+	}
+	size_t first_slot() const {
+		if (!n) return 0;
+		size_t k = 1;
+		while (2 * k <= n) k = 2 * k;
+		return k;
+	}
+	size_t next(size_t k) const {
+		if (2 * k + 1 <= n) {
+			k = 2 * k + 1;
+			while (2 * k <= n) k = 2 * k;
+			return k;
+		}
+		return k >> (__builtin_ctzll(~(unsigned long long)k) + 1);
+	}
+	/*
+	   from end() this is the last element, 0 before begin()
+	 */
+	size_t prev(size_t k) const {
+		if (!k) {
+			if (!n) return 0;
+			k = 1;
+			while (2 * k + 1 <= n) k = 2 * k + 1;
+			return k;
+		}
+		if (2 * k <= n) {
+			k = 2 * k;
+			while (2 * k + 1 <= n) k = 2 * k + 1;
+			return k;
+		}
+		return k >> (__builtin_ctzll(k) + 1);
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,477 @@
+/**
+ * implement a container like std::unordered_map
+ */
+#ifndef SJTU_UNORDERED_MAP_HPP
+#define SJTU_UNORDERED_MAP_HPP
+
+// only for std::hash<T> and std::equal_to<T>
+#include <functional>
+#include <cstddef>
+#include <new>
+#include <utility>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "utility.hpp"
+#include "exceptions.hpp"
+
+namespace sjtu {
+
+/**
+ * sixteen control bytes of unordered_map looked at together.
+ * a byte is empty (high bit set) or holds the low 7 bits of the hash of
+ *   the element in that slot, bit i of a mask stands for byte i.
+ */
+struct ctrl_group {
+	static const signed char empty = -128;
+	static const int width = 16;
+#if defined(__SSE2__)
+	__m128i v;
+
+	explicit ctrl_group(const signed char *p): v(_mm_loadu_si128((const __m128i*)p)) {}
+	unsigned match(signed char h) const {
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(h)));
+	}
+	unsigned match_empty() const {
+		return _mm_movemask_epi8(v);
+	}
+#else
+	const signed char *p;
+
+	explicit ctrl_group(const signed char *p): p(p) {}
+	unsigned match(signed char h) const {
+		unsigned m = 0;
+		for (int i = 0; i < width; ++i)
+			m |= unsigned(p[i] == h) << i;
+		return m;
+	}
+	unsigned match_empty() const {
+		unsigned m = 0;
+		for (int i = 0; i < width; ++i)
+			m |= unsigned(p[i] < 0) << i;
+		return m;
+	}
+#endif
+};
+
+/**
+ * a hash map with the interface of sjtu::map, without the order.
+ *
+ * the elements sit in one array with linear probing: an element is never
+ *   separated from the slot its hash points at by an empty slot.
+ *   a lookup checks the 16 slots from there with one compare of their
+ *   control bytes, and stops at the first group with an empty slot.
+ * erase moves the following elements of the run back instead of leaving
+ *   a tombstone, so lookups never slow down after many erases.
+ *
+ * when Hash and KeyEqual both define is_transparent, find, count and at
+ *   also take any type they accept, without building a Key.
+ *
+ * insert may rehash and erase may move elements:
+ *   both invalidate every iterator and reference.
+ */
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class KeyEqual = std::equal_to<Key>
+> class unordered_map {
+public:
+	/**
+	 * the internal type of data.
+	 * it should have a default constructor, a copy constructor.
+	 * You can use sjtu::map as value_type by typedef.
+	 */
+	typedef pair<const Key, T> value_type;
+
+	/**
+	 * see BidirectionalIterator at CppReference for help.
+	 * the order is the order of the slots, it changes on rehash.
+	 *
+	 * if there is anything wrong throw invalid_iterator.
+	 *     like it = map.begin(); --it;
+	 *       or it = map.end(); ++end();
+	 */
+	template<class reference, class pointer>
+	class base_iterator {
+		friend class unordered_map;
+		typedef base_iterator<value_type&, value_type*> iterator;
+		typedef base_iterator<const value_type&, const value_type*> const_iterator;
+	private:
+		unordered_map *self;
+		size_t i; // self->cap for end()
+
+	public:
+		base_iterator(): self(0), i(0) {}
+		base_iterator(unordered_map *self, size_t i): self(self), i(i) {}
+		base_iterator(const iterator &other): self(other.self), i(other.i) {}
+		base_iterator(const const_iterator &other): self(other.self), i(other.i) {}
+		base_iterator operator=(const base_iterator &other) {
+			if (this == &other) return *this;
+			self = other.self;
+			i = other.i;
+			return *this;
+		}
+		/**
+		 * iter++
+		 */
+		base_iterator operator++(int) {
+			base_iterator tmp = *this;
+			++(*this);
+			return tmp;
+		}
+		/**
+		 * ++iter
+		 */
+		base_iterator& operator++() {
+			if (!self || i >= self->cap)
+				throw invalid_iterator();
+			i = self->next_full(i + 1);
+			return *this;
+		}
+		/**
+		 * iter--
+		 */
+		base_iterator operator--(int) {
+			base_iterator tmp = *this;
+			--(*this);
+			return tmp;
+		}
+		/**
+		 * --iter
+		 */
+		base_iterator& operator--() {
+			if (!self)
+				throw invalid_iterator();
+			size_t j = i;
+			while (j && self->ctrl[j - 1] < 0) --j;
+			if (!j)
+				throw invalid_iterator();
+			i = j - 1;
+			return *this;
+		}
+		/**
+		 * some other operator for iterator.
+		 */
+		reference operator*() const {
+			return self->slots[i];
+		}
+		pointer operator->() const noexcept {
+			return self->slots + i;
+		}
+		/**
+		 * a operator to check whether two iterators are same (pointing to the same memory).
+		 */
+		bool operator==(const base_iterator &rhs) const {
+			return self == rhs.self && i == rhs.i;
+		}
+		bool operator!=(const base_iterator &rhs) const {
+			return !(*this == rhs);
+		}
+	};
+	typedef base_iterator<value_type&, value_type*> iterator;
+	typedef base_iterator<const value_type&, const value_type*> const_iterator;
+	/**
+	 * two constructors
+	 */
+	unordered_map(): ctrl(0), slots(0), cap(0), sz(0) {}
+	unordered_map(const unordered_map &o): ctrl(0), slots(0), cap(0), sz(0), hasher(o.hasher), eq(o.eq) {
+		copy(o);
+	}
+	/**
+	 * assignment operator
+	 */
+	unordered_map& operator=(const unordered_map &o) {
+		if (this == &o) {
+			return *this;
+		}
+		clear();
+		hasher = o.hasher;
+		eq = o.eq;
+		copy(o);
+		return *this;
+	}
+	/**
+	 * Destructors
+	 */
+	~unordered_map() {
+		clear();
+	}
+	/**
+	 * access specified element with bounds checking
+	 * Returns a reference to the mapped value of the element with key equivalent to key.
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	T& at(const Key &key) {
+		size_t i = locate(key);
+		if (i == cap)
+			throw index_out_of_bound();
+		return slots[i].second;
+	}
+	const T& at(const Key &key) const {
+		size_t i = locate(key);
+		if (i == cap)
+			throw index_out_of_bound();
+		return slots[i].second;
+	}
+	template<class K, class H = Hash, class = typename H::is_transparent, class E = KeyEqual, class = typename E::is_transparent>
+	T& at(const K &key) {
+		size_t i = locate(key);
+		if (i == cap)
+			throw index_out_of_bound();
+		return slots[i].second;
+	}
+	template<class K, class H = Hash, class = typename H::is_transparent, class E = KeyEqual, class = typename E::is_transparent>
+	const T& at(const K &key) const {
+		size_t i = locate(key);
+		if (i == cap)
+			throw index_out_of_bound();
+		return slots[i].second;
+	}
+	/**
+	 * access specified element
+	 * Returns a reference to the value that is mapped to a key equivalent to key,
+	 *   performing an insertion if such key does not already exist.
+	 */
+	T & operator[](const Key &key) {
+		size_t i = locate(key);
+		if (i == cap)
+			i = place(value_type(key, T()));
+		return slots[i].second;
+	}
+	/**
+	 * behave like at() throw index_out_of_bound if such key does not exist.
+	 */
+	const T & operator[](const Key &key) const {
+		return at(key);
+	}
+	/**
+	 * return a iterator to the beginning
+	 */
+	iterator begin() {
+		return iterator(this, next_full(0));
+	}
+	const_iterator cbegin() const {
+		return const_iterator(const_cast<unordered_map*>(this), next_full(0));
+	}
+	/**
+	 * return a iterator to the end
+	 * in fact, it returns past-the-end.
+	 */
+	iterator end() {
+		return iterator(this, cap);
+	}
+	const_iterator cend() const {
+		return const_iterator(const_cast<unordered_map*>(this), cap);
+	}
+	/**
+	 * checks whether the container is empty
+	 * return true if empty, otherwise false.
+	 */
+	bool empty() const {
+		return !sz;
+	}
+	/**
+	 * returns the number of elements.
+	 */
+	size_t size() const {
+		return sz;
+	}
+	/**
+	 * the number of slots, size() stays within 7/8 of it.
+	 */
+	size_t capacity() const {
+		return cap;
+	}
+	/**
+	 * clears the contents and frees the table
+	 */
+	void clear() {
+		for (size_t i = 0; i < cap; ++i)
+			if (ctrl[i] >= 0) slots[i].~value_type();
+		delete [] ctrl;
+		::operator delete(slots);
+		ctrl = 0;
+		slots = 0;
+		cap = sz = 0;
+	}
+	/**
+	 * make room for n elements, so that inserting up to n elements
+	 *   does not rehash.
+	 */
+	void reserve(size_t n) {
+		size_t c = ctrl_group::width;
+		while (c / 8 * 7 < n) c *= 2;
+		if (c > cap) rehash(c);
+	}
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<iterator, bool> insert(const value_type &value) {
+		size_t i = locate(value.first);
+		if (i != cap)
+			return pair<iterator, bool>(iterator(this, i), false);
+		return pair<iterator, bool>(iterator(this, place(value)), true);
+	}
+	/**
+	 * erase the element at pos.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(iterator pos) {
+		if (pos.self != this || pos.i >= cap || ctrl[pos.i] < 0) throw invalid_iterator();
+		size_t mask = cap - 1, hole = pos.i;
+		slots[hole].~value_type();
+		for (size_t k = (hole + 1) & mask; ctrl[k] >= 0; k = (k + 1) & mask) {
+			// k may fill the hole if its home slot is not in (hole, k]
+			size_t home = mix(hasher(slots[k].first)) >> 7 & mask;
+			if (((k - home) & mask) >= ((k - hole) & mask)) {
+				new (slots + hole) value_type(std::move(slots[k]));
+				slots[k].~value_type();
+				set_ctrl(hole, ctrl[k]);
+				hole = k;
+			}
+		}
+		set_ctrl(hole, ctrl_group::empty);
+		--sz;
+	}
+	/**
+	 * Returns the number of elements with key
+	 *   that compares equivalent to the specified argument,
+	 *   which is either 1 or 0
+	 *     since this container does not allow duplicates.
+	 */
+	size_t count(const Key &key) const {
+		return size_t(locate(key) != cap ? 1 : 0);
+	}
+	template<class K, class H = Hash, class = typename H::is_transparent, class E = KeyEqual, class = typename E::is_transparent>
+	size_t count(const K &key) const {
+		return size_t(locate(key) != cap ? 1 : 0);
+	}
+	/**
+	 * Finds an element with key equivalent to key.
+	 * key value of the element to search for.
+	 * Iterator to an element with key equivalent to key.
+	 *   If no such element is found, past-the-end (see end()) iterator is returned.
+	 */
+	iterator find(const Key &key) {
+		return iterator(this, locate(key));
+	}
+	const_iterator find(const Key &key) const {
+		return const_iterator(const_cast<unordered_map*>(this), locate(key));
+	}
+	template<class K, class H = Hash, class = typename H::is_transparent, class E = KeyEqual, class = typename E::is_transparent>
+	iterator find(const K &key) {
+		return iterator(this, locate(key));
+	}
+	template<class K, class H = Hash, class = typename H::is_transparent, class E = KeyEqual, class = typename E::is_transparent>
+	const_iterator find(const K &key) const {
+		return const_iterator(const_cast<unordered_map*>(this), locate(key));
+	}
+
+private:
+	signed char *ctrl; // cap bytes, then the first width - 1 of them again
+	value_type *slots;
+	size_t cap, sz; // cap is 0 or a power of two not less than width
+	Hash hasher;
+	KeyEqual eq;
+
+	/*
+	   std::hash of an integer is often the integer itself,
+	   spread it so that both the low 7 bits and the slot bits are usable
+	 */
+	static size_t mix(size_t h) {
+		return size_t(mix_bits(h));
+	}
+	void set_ctrl(size_t i, signed char c) {
+		ctrl[i] = c;
+		if (i < ctrl_group::width - 1)
+			ctrl[cap + i] = c;
+	}
+	size_t next_full(size_t i) const {
+		while (i < cap && ctrl[i] < 0) ++i;
+		return i;
+	}
+	/*
+	   the slot holding key, or cap
+	 */
+	template<class K>
+	size_t locate(const K &key) const {
+		if (!sz) return cap;
+		size_t h = mix(hasher(key)), mask = cap - 1, i = h >> 7 & mask;
+		signed char h2 = h & 0x7f;
+		for (;;) {
+			ctrl_group g(ctrl + i);
+			for (unsigned m = g.match(h2); m; m &= m - 1) {
+				size_t j = (i + __builtin_ctz(m)) & mask;
+				if (eq(slots[j].first, key)) return j;
+			}
+			if (g.match_empty()) return cap;
+			i = (i + ctrl_group::width) & mask;
+		}
+	}
+	/*
+	   the first empty slot from the home of hash h
+	 */
+	size_t free_slot(size_t h) const {
+		size_t mask = cap - 1, i = h >> 7 & mask;
+		for (;;) {
+			unsigned m = ctrl_group(ctrl + i).match_empty();
+			if (m) return (i + __builtin_ctz(m)) & mask;
+			i = (i + ctrl_group::width) & mask;
+		}
+	}
+	/*
+	   put a value whose key is known to be absent, returns its slot
+	 */
+	size_t place(const value_type &value) {
+		if (sz + 1 > cap / 8 * 7)
+			rehash(cap ? cap * 2 : ctrl_group::width);
+		size_t h = mix(hasher(value.first)), i = free_slot(h);
+		new (slots + i) value_type(value);
+		set_ctrl(i, h & 0x7f);
+		++sz;
+		return i;
+	}
+	void allocate(size_t c) {
+		cap = c;
+		ctrl = new signed char[c + ctrl_group::width - 1];
+		for (size_t i = 0; i < c + ctrl_group::width - 1; ++i)
+			ctrl[i] = ctrl_group::empty;
+		slots = static_cast<value_type*>(::operator new(c * sizeof(value_type)));
+	}
+	void rehash(size_t c) {
+		signed char *old_ctrl = ctrl;
+		value_type *old = slots;
+		size_t old_cap = cap;
+		allocate(c);
+		for (size_t i = 0; i < old_cap; ++i) {
+			if (old_ctrl[i] < 0) continue;
+			size_t j = free_slot(mix(hasher(old[i].first)));
+			new (slots + j) value_type(std::move(old[i]));
+			old[i].~value_type();
+			set_ctrl(j, old_ctrl[i]);
+		}
+		delete [] old_ctrl;
+		::operator delete(old);
+	}
+	/*
+	   same capacity, every element stays in its slot
+	 */
+	void copy(const unordered_map &o) {
+		if (!o.cap) return;
+		allocate(o.cap);
+		for (size_t i = 0; i < cap + ctrl_group::width - 1; ++i)
+			ctrl[i] = o.ctrl[i];
+		for (size_t i = 0; i < cap; ++i)
+			if (ctrl[i] >= 0) new (slots + i) value_type(o.slots[i]);
+		sz = o.sz;
+	}
+};
+
+}
+
+#endif
@@ -2,6 +2,13 @@
 #define SJTU_UTILITY_HPP
 
 #include <utility>
+#include <functional>
+#include <new>
+#include <type_traits>
+#if defined(__cpp_impl_three_way_comparison) && __cpp_impl_three_way_comparison >= 201907L
+#include <compare>
+#define SJTU_HAS_THREE_WAY 1
+#endif
 
 namespace sjtu {
 
@@ -15,12 +22,95 @@ public:
 	pair(pair &&other) = default;
 	pair(const T1 &x, const T2 &y) : first(x), second(y) {}
 	template<class U1, class U2>
-	pair(U1 &&x, U2 &&y) : first(x), second(y) {}
+	pair(U1 &&x, U2 &&y) : first(std::forward<U1>(x)), second(std::forward<U2>(y)) {}
 	template<class U1, class U2>
 	pair(const pair<U1, U2> &other) : first(other.first), second(other.second) {}
 	template<class U1, class U2>
-	pair(pair<U1, U2> &&other) : first(other.first), second(other.second) {}
+	pair(pair<U1, U2> &&other) : first(std::move(other.first)), second(std::move(other.second)) {}
+};
+
+/**
+ * three_way(cmp, a, b) is negative, zero or positive as a goes before,
+ *   together with or after b under cmp, found with a single comparison
+ *   whenever one is available:
+ *   - cmp.compare(a, b), if Compare has such a member;
+ *   - a.compare(b), if cmp is std::less (std::string has it);
+ *   - a <=> b, if cmp is std::less and the key has it (C++20);
+ *   - otherwise cmp(a, b), and cmp(b, a) only when that is false.
+ * a compare() that returns bool is not taken for a three-way one.
+ */
+struct three_way_rank0 {};
+struct three_way_rank1 : three_way_rank0 {};
+struct three_way_rank2 : three_way_rank1 {};
+struct three_way_rank3 : three_way_rank2 {};
+
+template<class R>
+using three_way_int = typename std::enable_if<!std::is_same<typename std::decay<R>::type, bool>::value, int>::type;
+
+template<class C, class A, class B>
+inline int three_way(const C &cmp, const A &a, const B &b, three_way_rank0) {
+	return cmp(a, b) ? -1 : cmp(b, a) ? 1 : 0;
+}
+#ifdef SJTU_HAS_THREE_WAY
+template<class K, class A, class B>
+inline auto three_way(const std::less<K> &, const A &a, const B &b, three_way_rank1) -> decltype(a <=> b, int()) {
+	auto c = a <=> b;
+	return c < 0 ? -1 : c > 0 ? 1 : 0;
+}
+#endif
+template<class K, class A, class B>
+inline auto three_way(const std::less<K> &, const A &a, const B &b, three_way_rank2)
+	-> three_way_int<decltype(a.compare(b))> {
+	int c = a.compare(b);
+	return c;
+}
+template<class C, class A, class B>
+inline auto three_way(const C &cmp, const A &a, const B &b, three_way_rank3)
+	-> three_way_int<decltype(cmp.compare(a, b))> {
+	int c = cmp.compare(a, b);
+	return c;
+}
+template<class C, class A, class B>
+inline int three_way(const C &cmp, const A &a, const B &b) {
+	return three_way(cmp, a, b, three_way_rank3());
+}
+
+/**
+ * tag telling a constructor that its input is sorted by key
+ *   and has no duplicate keys.
+ */
+struct sorted_unique_t {
+	explicit sorted_unique_t() {}
 };
+const sorted_unique_t sorted_unique = sorted_unique_t();
+
+/**
+ * the 64-bit finalizer of murmur3: every bit of x reaches every bit of
+ *   the result. for hashes and for seeds taken from addresses.
+ */
+inline unsigned long long mix_bits(unsigned long long x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+/**
+ * a nonzero 32-bit xorshift seed from x.
+ */
+inline unsigned scramble(unsigned long long x) {
+	return unsigned(mix_bits(x)) | 1;
+}
+/**
+ * move *from into the raw slot to and destroy *from,
+ *   so neither needs operator=.
+ */
+template<class U>
+inline void relocate(U *from, U *to) {
+	new (to) U(std::move(*from));
+	from->~U();
+}
 
 }
 